@@ -1,15 +1,22 @@
 #version 450 core
 
 layout(location = 0) in vec3 _Coord;
-layout(location = 1) in vec2 _TexCoord;
+layout(location = 1) in vec2 _TexCoord; // in voxels, a quad may cover many of them
+layout(location = 2) in vec3 _Color; // per vertex of a mesh, or per instance
+// only set per instance by the instanced path, a mesh leaves it at the default (0, 0, 0)
+layout(location = 3) in vec3 _Offset;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+// updated once per frame, shared by all shaders
+layout(std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 proj;
+};
 
 out vec2 TexCoord;
+out vec3 Color;
 
 void main() {
     TexCoord = _TexCoord;
-    gl_Position = proj * view * model * vec4(_Coord, 1.0);
+    Color = _Color;
+    gl_Position = proj * view * vec4(_Coord + _Offset, 1.0);
 }
@@ -7,6 +7,8 @@
 #include <GLFW/glfw3.h>
 
 #include "Config.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
 #include "Timer.h"
 #include "UI.h"
 
@@ -50,18 +52,34 @@ void Application::Run(const std::function<void(float)> &callback)
     auto t1 = ch::steady_clock::now();
     float dt = 0.0f;
 
+    // the whole GPU work of a frame, in two parts which don't overlap
+    GpuTimer sceneGpuTimer("GPU: scene"), uiGpuTimer("GPU: UI");
+
     while (!glfwWindowShouldClose(_pWindow))
     {
+        PROFILE_SCOPE("Frame");
+
+        sceneGpuTimer.Begin();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         gTimer.Tick(dt);
 
         ui::NewFrame();
         callback(dt);
-        ui::Render();
-
-        glfwPollEvents();
-        glfwSwapBuffers(_pWindow);
+        sceneGpuTimer.End();
+
+        {
+            PROFILE_SCOPE("Frame: UI render");
+            uiGpuTimer.Begin();
+            ui::Render();
+            uiGpuTimer.End();
+        }
+
+        {
+            PROFILE_SCOPE("Frame: events & swap"); // mostly waiting for the vsync
+            glfwPollEvents();
+            glfwSwapBuffers(_pWindow);
+        }
 
         auto t2 = ch::steady_clock::now();
         dt = ch::duration_cast<ch::microseconds>(t2 - t1).count() / 1000000.0;
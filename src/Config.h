@@ -6,3 +6,7 @@ constexpr int cWindowHeight = 1200;
 constexpr const char *cpGlslVersion = "#version 450";
 constexpr const char *cpDefaultFontPath = "resources/consola.ttf";
 constexpr int cDefaultFontSize = 25;
+constexpr int cProfileScopeMaxNum = 64; // named timing scopes of the profiler
+constexpr int cProfileSampleNum = 128;  // the last runs kept per scope
+constexpr int cLogRingSize = 4096; // log records queued for the logger thread, a power of 2
+constexpr int cLogArgsSize = 192;  // bytes of arguments per log record, longer strings are truncated
@@ -0,0 +1,41 @@
+#include "GpuTimer.h"
+
+#include <glad/glad.h>
+
+#include "Profiler.h"
+
+GpuTimer::GpuTimer(const char *name) : _ScopeID(gProfiler.RegisterScope(name))
+{
+    glGenQueries(2, _Queries);
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(2, _Queries);
+}
+
+void GpuTimer::Begin()
+{
+    glBeginQuery(GL_TIME_ELAPSED, _Queries[_Current]);
+}
+
+void GpuTimer::End()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    _Pending[_Current] = true;
+    _Current ^= 1;
+
+    // the previous frame, its query is reused by the next Begin
+    if (_Pending[_Current])
+    {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(_Queries[_Current], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 elapsed = 0; // ns
+            glGetQueryObjectui64v(_Queries[_Current], GL_QUERY_RESULT, &elapsed);
+            gProfiler.Record(_ScopeID, elapsed / 1000000.0f);
+        }
+        _Pending[_Current] = false;
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// the GPU time of a part of the frame, measured by GL_TIME_ELAPSED queries and recorded as a profiler scope of its own
+// two queries are used in turn: the result of the previous frame is read after the current one is issued (double-buffered readback)
+// by then the GPU has normally finished it, so the CPU never waits (a result which is still not available is dropped)
+// GL_TIME_ELAPSED queries can't be nested, so the parts timed by different GPU timers must not overlap
+class GpuTimer
+{
+public:
+    explicit GpuTimer(const char *name); // the GL context must be current
+    GpuTimer(const GpuTimer &) = delete; // owns the GL queries
+    GpuTimer &operator=(const GpuTimer &) = delete;
+    ~GpuTimer();
+
+    void Begin();
+    void End();
+
+private:
+    int _ScopeID;
+    unsigned _Queries[2];
+    bool _Pending[2] = {false, false}; // issued, but the result is not read yet
+    int _Current = 0;                  // the query of this frame
+};
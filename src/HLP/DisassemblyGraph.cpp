@@ -1,218 +1,579 @@
 #include "DisassemblyGraph.h"
 
-#include <fstream>
-#include <queue>
+#include <algorithm>
 #include <stack>
 
 #include "Logger.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
 
 #include "HLP_Config.h"
+#include "PuzzleFile.h"
 
 bool DisassemblyGraph::ImportPuzzle(const std::string &puzzleFilePath)
 {
-    _GraphEdges.clear();
+    _ImportError.clear();
+
+    // binary puzzle files are mapped and used in place, text ones are parsed
+    if (DetectPuzzleFileFormat(puzzleFilePath) == PuzzleFileFormat::BINARY)
+    {
+        auto geometry = std::make_unique<PuzzleGeometry>();
+        if (!MapBinaryPuzzleFile(puzzleFilePath, *geometry))
+        {
+            _ImportError = "unable to read the puzzle file";
+            return false;
+        }
+
+        return _ImportGeometry(std::move(geometry));
+    }
+
+    std::vector<PuzzlePiece> pieces;
+    if (!ReadTextPuzzleFile(puzzleFilePath, pieces))
+    {
+        _ImportError = "unable to read the puzzle file";
+        return false;
+    }
+
+    return ImportPuzzle(std::move(pieces));
+}
+
+bool DisassemblyGraph::ImportPuzzle(std::vector<PuzzlePiece> &&pieces)
+{
+    _ImportError.clear();
+
+    // the voxels of all pieces are stored in one block
+    auto geometry = std::make_unique<PuzzleGeometry>();
+    std::size_t voxelNum = 0;
+    for (auto &piece : pieces)
+    {
+        voxelNum += piece._Voxels.size();
+    }
+
+    geometry->_Voxels.reserve(voxelNum);
+    geometry->_Pieces.resize(pieces.size());
+    for (int i = 0; i < static_cast<int>(pieces.size()); i++)
+    {
+        auto voxelOffset = geometry->_Voxels.size();
+        geometry->_Voxels.insert(geometry->_Voxels.end(), pieces[i]._Voxels.begin(), pieces[i]._Voxels.end());
+        geometry->_Pieces[i]._Voxels = std::span(geometry->_Voxels).subspan(voxelOffset, pieces[i]._Voxels.size());
+    }
+
+    return _ImportGeometry(std::move(geometry));
+}
+
+bool DisassemblyGraph::_ImportGeometry(std::unique_ptr<PuzzleGeometry> &&geometry)
+{
+    PROFILE_SCOPE("Solver: import puzzle");
+
+    int pieceNum = geometry->_Pieces.size();
+    if (pieceNum <= 0 || pieceNum > cMaxPieceNum)
+    {
+        _ImportError = std::to_string(pieceNum) + " piece(s), the solver supports 1 ~ " + std::to_string(cMaxPieceNum) + " (cMaxPieceNum)";
+        LOG_ERROR("Puzzles with %d puzzle pieces are not supported! (at most %d)", pieceNum, cMaxPieceNum);
+        return false;
+    }
+
+    // content hash: the pieces in ID order, their voxels in the stored order
+    std::uint64_t puzzleHash = Mix64(pieceNum);
+    for (auto &piece : geometry->_Pieces)
+    {
+        if (piece._Voxels.empty())
+        {
+            _ImportError = "a piece without any voxel";
+            LOG_ERROR("Puzzle pieces without any voxel are not allowed!");
+            return false;
+        }
+
+        piece.CalculateBoundingBox();
+
+        puzzleHash = Mix64(puzzleHash ^ piece._Voxels.size());
+        for (auto &voxel : piece._Voxels)
+        {
+            std::uint64_t packed = static_cast<std::uint32_t>(voxel._X) | std::uint64_t(static_cast<std::uint32_t>(voxel._Z)) << 32;
+            puzzleHash = Mix64(puzzleHash ^ packed);
+        }
+    }
+
     _GraphNodes.clear();
+    _StateArena.Clear();
     _GraphNodesParents.clear();
+    _GraphNodesMoves.clear();
+    _GraphNodesKeys.clear();
+    _GraphEdges.clear();
+    _GraphNodesIndex.clear();
     _TargetNodeIDs.clear();
     _DisassemblyPlan.clear();
     _MinTargetNodeDepth = 0x3f3f3f3f;
     _DisasmGraphBuilt = false;
     _PrevTargetNodeID = -1;
+    _SubassemblyPlans.clear();
+    _CancelRequested = false;
+    _MemoryLimitExceeded = false;
+    _TreeMemoryUsage = 0; // the sub-graphs are gone with their plans (a sub-graph is imported only once, before it's counted)
+    _CountedMemoryUsage = 0;
+    _SearchBudgetExceeded = false;
+    _PuzzleHash = puzzleHash;
+    _LiveConfigs.clear();
+    _ConfigCache.clear();
+    _ConfigCache.resize(cConfigCacheSize); // at least 2, see GetPuzzleConfig
+
+    // the geometry is stored only once, every config refers to it
+    _Geometry = std::move(geometry);
+
+    // acceleration structures of the configs are built on demand
+    Arena<PuzzlePieceState> rootStateArena;
+    _AddPuzzleConfig(PuzzleConfig(_Geometry.get(), 0, rootStateArena), -1); // rootNode has no parents..
+    {
+        std::lock_guard lock(_ProgressMutex);
+        _Progress = BuildProgress();
+    }
+    _ReportProgress(0, 1, 0);
+
+    LOG_INFO("Successfully imported puzzle with %d puzzle pieces", pieceNum);
+
+    return true;
+}
+
+void DisassemblyGraph::SetCompactStorage(bool compact)
+{
+    _CompactStorage = compact;
+}
+
+bool DisassemblyGraph::IsCompactStorage() const
+{
+    return _CompactStorage;
+}
+
+void DisassemblyGraph::SetMemoryLimit(std::size_t bytes)
+{
+    _MemoryLimit = bytes;
+}
+
+bool DisassemblyGraph::IsMemoryLimitExceeded() const
+{
+    return _MemoryLimitExceeded;
+}
+
+void DisassemblyGraph::SetSearchBudget(int maxDepth, int maxExpandedNum)
+{
+    _MaxSearchDepth = maxDepth;
+    _MaxExpandedNum = maxExpandedNum;
+}
+
+bool DisassemblyGraph::IsSearchBudgetExceeded() const
+{
+    return _SearchBudgetExceeded;
+}
 
-    // load the puzzle file as the initial puzzle config
-    std::ifstream fin(puzzleFilePath);
-    if (!fin)
+void DisassemblyGraph::SetParallelBuild(bool parallel)
+{
+    _ParallelBuild = parallel;
+}
+
+PuzzleConfig &DisassemblyGraph::GetPuzzleConfig(int configID)
+{
+    if (auto config = _FindLiveConfig(configID))
     {
-        LOG_ERROR("Unable to open the configuation file!");
-        return false;
+        return *config;
     }
 
-    // check if the file is valid
-    int magicNumber = 0;
-    fin >> magicNumber;
-    if (magicNumber != cPuzzleFileMagicNumber)
+    // compact storage: walk up to the closest config which is stored in full (the root always is), then replay the moves
+    std::vector<int> path;
+    PuzzleConfig *ancestor = nullptr;
+    for (int id = configID; !ancestor; id = _GraphNodesParents[id])
     {
-        LOG_ERROR("This is not a valid configuration file!");
-        return false;
+        ancestor = _FindLiveConfig(id);
+        ancestor = ancestor ? ancestor : _FindCachedConfig(id);
+        if (!ancestor)
+        {
+            path.push_back(id);
+        }
     }
 
-    // load:
-    // 1. the number of puzzle pieces
-    // 2. the x-axis size of puzzle
-    // 3. the z-axis size of puzzle
-    int pieceNum = 0;
-    fin >> pieceNum;
-    auto &rootNode = _GraphNodes.emplace_back(std::make_shared<PuzzleConfig>(0, pieceNum));
-    _GraphEdges.emplace_back();
-    _GraphNodesParents.push_back(-1); // rootNode has no parents..
+    if (path.empty())
+    {
+        return *ancestor; // cached
+    }
 
-    // load each puzzle piece
-    for (int i = 0; i < pieceNum; i++)
+    // the ancestor has just been used, so it's never the least recently used entry
+    auto &entry = *std::min_element(_ConfigCache.begin(), _ConfigCache.end(),
+                                    [](const CachedConfig &lhs, const CachedConfig &rhs) { return lhs._LastUse < rhs._LastUse; });
+    entry._StateArena.Clear();
+    entry._Config = ancestor->MakeNeighborConfig(_GraphNodesMoves[path.back()], entry._StateArena);
+    for (int i = static_cast<int>(path.size()) - 2; i >= 0; i--)
     {
-        auto piece = std::make_shared<PuzzlePiece>();
+        entry._Config.ApplyMove(_GraphNodesMoves[path[i]]);
+    }
+    entry._ConfigID = configID;
+    entry._LastUse = ++_ConfigCacheClock;
+
+    return entry._Config;
+}
 
-        int voxelNum = 0, x = 0, z = 0;
-        fin >> voxelNum;
+void DisassemblyGraph::CalculateNeighborConfigs(int configID, std::vector<PuzzleConfig> &neighborConfigs,
+                                                Arena<PuzzlePieceState> &stateArena)
+{
+    GetPuzzleConfig(configID).CalculateNeighborConfigs(neighborConfigs, stateArena);
+}
 
-        for (int j = 0; j < voxelNum; j++)
+int DisassemblyGraph::GetPuzzleConfigNum() const
+{
+    return _GraphNodesParents.size();
+}
+
+void DisassemblyGraph::Test_AddAllNeighborConfigs(int configID)
+{
+    std::vector<PuzzleConfig> neighborConfigs;
+    Arena<PuzzlePieceState> stateArena;
+    CalculateNeighborConfigs(configID, neighborConfigs, stateArena);
+    for (auto &neighbor : neighborConfigs)
+    {
+        _AddPuzzleConfig(std::move(neighbor), configID);
+    }
+}
+
+int DisassemblyGraph::_FindPuzzleConfig(const PuzzleConfig &config)
+{
+    // only configs with the same key need a full comparison
+    // with compact storage, they are almost always live: the BFS only finds configs of the previous, current and next level again
+    // time complexity: O(1) on average, the load factor is kept <= 0.5
+    if (_GraphNodesIndex.empty())
+    {
+        return -1;
+    }
+
+    std::size_t slotMask = _GraphNodesIndex.size() - 1;
+    for (std::size_t slot = config.GetHash() & slotMask; _GraphNodesIndex[slot] != -1; slot = (slot + 1) & slotMask)
+    {
+        int configID = _GraphNodesIndex[slot];
+        if (_GraphNodesKeys[configID] == config.GetHash() && config.IsEqualTo(GetPuzzleConfig(configID)))
         {
-            fin >> x >> z;
-            piece->_Voxels.emplace_back(x, z);
+            return configID;
         }
-
-        rootNode->AddPuzzlePiece(i, piece);
     }
 
-    fin.close();
+    return -1;
+}
 
-    // generate acceleration structures of the config
-    rootNode->BuildAccelStructures();
+int DisassemblyGraph::_AddPuzzleConfig(PuzzleConfig &&config, int parentID, Arena<PuzzlePieceState> *liveStateArena)
+{
+    int newConfigID = _GraphNodesParents.size();
+    _GraphNodesParents.push_back(parentID);
+    _GraphNodesMoves.push_back(config.GetLastMove());
+    _GraphNodesKeys.push_back(config.GetHash());
 
-    // assign the materials to the pieces
-    // in order to distinguish them
-    rootNode->AssignPuzzlePieceMaterials();
+    if (!_CompactStorage || newConfigID == 0)
+    {
+        config.RelocateStates(_StateArena);
+        _GraphNodes.push_back(std::move(config));
+    }
+    else if (liveStateArena)
+    {
+        config.RelocateStates(*liveStateArena);
+        _LiveConfigs.emplace(newConfigID, std::move(config));
+    }
 
-    LOG_INFO("Successfully imported puzzle with %d puzzle pieces", pieceNum);
+    if (_GraphNodesParents.size() * 2 > _GraphNodesIndex.size())
+    {
+        _RebuildGraphNodesIndex(std::max<std::size_t>(64, _GraphNodesIndex.size() * 2));
+    }
+    else
+    {
+        _IndexPuzzleConfig(newConfigID);
+    }
 
-    return true;
+    return newConfigID;
 }
 
-PuzzleConfig &DisassemblyGraph::GetPuzzleConfig(int configID)
+PuzzleConfig *DisassemblyGraph::_FindLiveConfig(int configID)
 {
-    return *_GraphNodes[configID];
+    if (configID < static_cast<int>(_GraphNodes.size()))
+    {
+        return &_GraphNodes[configID];
+    }
+
+    auto iter = _LiveConfigs.find(configID);
+    return iter == _LiveConfigs.end() ? nullptr : &iter->second;
 }
 
-void DisassemblyGraph::RenderConfig(int configID, Shader &shader, VertexBuffer &voxelModel)
+PuzzleConfig *DisassemblyGraph::_FindCachedConfig(int configID)
 {
-    _GraphNodes[configID]->Render(shader, voxelModel);
+    for (auto &entry : _ConfigCache)
+    {
+        if (entry._ConfigID == configID)
+        {
+            entry._LastUse = ++_ConfigCacheClock;
+            return &entry._Config;
+        }
+    }
+
+    return nullptr;
 }
 
-void DisassemblyGraph::CalculateNeighborConfigs(int configID, std::vector<std::shared_ptr<PuzzleConfig>> &neighborConfigs)
+void DisassemblyGraph::_MakeLive(int configID, Arena<PuzzlePieceState> &liveStateArena)
 {
-    _GraphNodes[configID]->CalculateNeighborConfigs(neighborConfigs);
+    if (!_FindLiveConfig(configID))
+    {
+        _LiveConfigs.emplace(configID, GetPuzzleConfig(configID).Clone(liveStateArena));
+    }
 }
 
-int DisassemblyGraph::GetPuzzleConfigNum() const
+void DisassemblyGraph::_ReleaseLiveConfig(int configID)
 {
-    return _GraphNodes.size();
+    if (configID < static_cast<int>(_GraphNodes.size()))
+    {
+        _GraphNodes[configID].ReleaseAccelStructures();
+    }
+    else
+    {
+        _LiveConfigs.erase(configID);
+    }
 }
 
-void DisassemblyGraph::Test_AddAllNeighborConfigs(int configID)
+void DisassemblyGraph::_IndexPuzzleConfig(int configID)
+{
+    std::size_t slotMask = _GraphNodesIndex.size() - 1;
+    std::size_t slot = _GraphNodesKeys[configID] & slotMask;
+    while (_GraphNodesIndex[slot] != -1)
+    {
+        slot = (slot + 1) & slotMask;
+    }
+    _GraphNodesIndex[slot] = configID;
+}
+
+void DisassemblyGraph::_RebuildGraphNodesIndex(std::size_t slotNum)
 {
-    std::vector<std::shared_ptr<PuzzleConfig>> neighborConfigs;
-    CalculateNeighborConfigs(configID, neighborConfigs);
-    for (auto neighbor : neighborConfigs)
+    // slotNum must be a power of 2
+    _GraphNodesIndex.assign(slotNum, -1);
+    for (int configID = 0; configID < GetPuzzleConfigNum(); configID++)
     {
-        _GraphNodes.push_back(neighbor);
+        _IndexPuzzleConfig(configID);
     }
 }
 
-void DisassemblyGraph::BuildKernelDisassemblyGraph(int configID, int relativeDepth, int fullConfigDelta)
+void DisassemblyGraph::_CompactGraphEdges(std::size_t sortedEdgeNum)
 {
-    if (_GraphNodes.empty())
+    // the first sortedEdgeNum edges are already sorted and unique, only the new ones are sorted before merging
+    auto middle = _GraphEdges.begin() + sortedEdgeNum;
+    std::sort(middle, _GraphEdges.end());
+    std::inplace_merge(_GraphEdges.begin(), middle, _GraphEdges.end());
+    _GraphEdges.erase(std::unique(_GraphEdges.begin(), _GraphEdges.end()), _GraphEdges.end());
+}
+
+bool DisassemblyGraph::BuildKernelDisassemblyGraph(int configID, int relativeDepth, int fullConfigDelta)
+{
+    if (_GraphNodesParents.empty())
     {
         LOG_ERROR("No puzzle cam be disassembled :( Please generate or import one.");
-        return;
+        return false;
     }
 
+    PROFILE_SCOPE("Solver: kernel graph");
+
+    // the lock is released only while expanding a level, when nothing but the live configs' acceleration structures change
+    std::unique_lock graphLock(_GraphMutex);
+
     int currentMinTargetNodeDepth = 0x3f3f3f3f;
     _TargetNodeIDs.clear();
 
-    std::unordered_map<int, bool> visit;
-    std::queue<int> queue;
-    queue.push(configID);
-    visit[configID] = false;
+    // level-synchronous BFS:
+    // 1. all configs of the current depth are expanded concurrently (they are independent of each other)
+    // 2. the neighbors are merged into the graph on this thread, in the order of the frontier
+    //    so the resulting graph is the same whatever the number of threads is
+    // the expanded configs derive their acceleration structures from their parents (expanded one level before)
+    // so the structures of a level are only released after the next level has been expanded
+    // with compact storage, the configs of a level are dropped at the same time (they stay live for three levels)
+    int level = 0;
+    if (_CompactStorage)
+    {
+        _MakeLive(configID, _LiveStateArenas[0]);
+    }
 
-    while (!queue.empty())
+    std::vector<int> frontier = {configID};
+    std::vector<int> prevFrontier;
+    std::size_t sortedEdgeNum = _GraphEdges.size();
+    int expandedNum = 0; // by this BFS, for the search budget
+
+    while (!frontier.empty() && !_IsCancelRequested())
     {
-        int frontConfigID = queue.front();
-        queue.pop();
+        int currentDepth = _FindLiveConfig(frontier.front())->GetDepth(); // all configs in the frontier have the same depth
 
-        if (visit[frontConfigID]) // don't visit the same node again!
+        std::vector<int> expandedConfigIDs;
+        for (auto frontConfigID : frontier)
         {
-            continue;
+            if (!_FindLiveConfig(frontConfigID)->IsFullConfig(fullConfigDelta))
+            {
+                currentMinTargetNodeDepth = std::min(currentMinTargetNodeDepth, currentDepth);
+                _TargetNodeIDs[currentDepth - relativeDepth] = frontConfigID;
+            }
+            else
+            {
+                expandedConfigIDs.push_back(frontConfigID);
+            }
         }
 
-        auto &frontConfig = _GraphNodes[frontConfigID];
-        int currentDepth = frontConfig->GetDepth();
+        if (currentDepth >= currentMinTargetNodeDepth) // pruning
+        {
+            break;
+        }
 
-        if (!frontConfig->IsFullConfig(fullConfigDelta))
+        int expandedConfigNum = expandedConfigIDs.size();
+        // a removal at a deeper level would exceed the budget anyway
+        if ((_MaxSearchDepth > 0 && currentDepth - relativeDepth >= _MaxSearchDepth) ||
+            (_MaxExpandedNum > 0 && expandedNum + expandedConfigNum > _MaxExpandedNum))
         {
-            currentMinTargetNodeDepth = std::min(currentMinTargetNodeDepth, currentDepth);
-            _TargetNodeIDs[currentDepth - relativeDepth] = frontConfigID;
+            _SearchBudgetExceeded = true;
+            break;
         }
-        else if (currentDepth < currentMinTargetNodeDepth) // pruning
+        expandedNum += expandedConfigNum;
+
+        // the neighbors are short-lived: each expanded config gets its own arena for their states (no locking)
+        // only the new configs copy their states into _StateArena, the rest is freed with the arenas after merging
+        std::vector<std::vector<PuzzleConfig>> pendingNeighbors(expandedConfigNum);
+        std::vector<Arena<PuzzlePieceState>> pendingStateArenas;
+        pendingStateArenas.reserve(expandedConfigNum);
+        for (int i = 0; i < expandedConfigNum; i++)
         {
-            std::vector<int> pendingNeighbors;
-            std::vector<std::shared_ptr<PuzzleConfig>> neighborConfigs;
-            CalculateNeighborConfigs(frontConfigID, neighborConfigs);
+            pendingStateArenas.emplace_back(_Geometry->_Pieces.size() * 16);
+        }
 
-            int neighborCnt = neighborConfigs.size();
+        _ReportProgress(0, frontier.size(), currentDepth);
 
-            for (int k = 0; k < neighborCnt; k++)
-            {
-                auto &neighborConfig = neighborConfigs[k];
+        graphLock.unlock();
+        {
+            PROFILE_SCOPE("Solver: expand level");
+            auto ExpandConfig = [&](int i) {
+                if (_IsCancelRequested())
+                {
+                    return; // the level is merged as far as it's expanded
+                }
+
+                auto &neighborConfigs = pendingNeighbors[i];
+                auto &config = *_FindLiveConfig(expandedConfigIDs[i]);
+                int parentID = _GraphNodesParents[expandedConfigIDs[i]];
+                auto parentConfig = (parentID != -1) ? _FindLiveConfig(parentID) : nullptr;
+                if (parentConfig && parentConfig->HasAccelStructures())
+                {
+                    config.DeriveAccelStructures(*parentConfig);
+                }
+                else
+                {
+                    config.BuildAccelStructures();
+                }
 
                 // the paper missed an important assumption!!
                 // if found a target node, don't check other neighbors, only add the target node
                 // or this function will NEVER STOP!
-                if (!neighborConfig->IsFullConfig(fullConfigDelta))
-                {
-                    pendingNeighbors.clear();
-                    pendingNeighbors.push_back(k);
-                    break;
-                }
+                // removals are generated first, so the moves are never generated if a target node is found
+                config.GenerateNeighborConfigs(pendingStateArenas[i], [&](PuzzleConfig &neighborConfig) {
+                    if (!neighborConfig.IsFullConfig(fullConfigDelta))
+                    {
+                        neighborConfigs.clear();
+                        neighborConfigs.push_back(std::move(neighborConfig));
+                        return false;
+                    }
 
-                pendingNeighbors.push_back(k);
-            }
+                    neighborConfigs.push_back(std::move(neighborConfig));
+                    return true;
+                });
+            };
 
-            for (auto pendingNeighborConfig : pendingNeighbors)
+            if (_ParallelBuild)
+            {
+                gThreadPool.ParallelFor(expandedConfigNum, ExpandConfig);
+            }
+            else
             {
-                // check if the neighborConfig has already been in _GraphNodes
-                // by brute force though.. I can't figure out a better approach
-                bool alreadyExistConfig = false;
-                int existConfigID = -1;
-                int n = _GraphNodes.size();
-                for (int i = 0; i < n; i++)
+                for (int i = 0; i < expandedConfigNum; i++)
                 {
-                    if (neighborConfigs[pendingNeighborConfig]->IsEqualTo(*_GraphNodes[i]))
-                    {
-                        alreadyExistConfig = true;
-                        existConfigID = i;
-                        break;
-                    }
+                    ExpandConfig(i);
                 }
+            }
+        }
+        graphLock.lock();
 
-                if (alreadyExistConfig) // if neighborConfig is already in _GraphNodes, find its ID in _GraphNodes
-                {
-                    // the depth of that "already existing" config must be the same as or shallower than current config
-                    // no need to update the preceding node
-                    _GraphEdges[existConfigID].insert(frontConfigID);
-                    _GraphEdges[frontConfigID].insert(existConfigID);
-                }
-                else
+        std::vector<int> nextFrontier;
+        {
+            PROFILE_SCOPE("Solver: merge level");
+            for (int i = 0; i < expandedConfigNum; i++)
+            {
+                int frontConfigID = expandedConfigIDs[i];
+
+                for (auto &neighborConfig : pendingNeighbors[i])
                 {
-                    int newConfigID = _GraphNodes.size();
-                    _GraphNodes.push_back(neighborConfigs[pendingNeighborConfig]);
-                    _GraphEdges.emplace_back();
-                    _GraphNodesParents.push_back(frontConfigID);
+                    // check if the neighborConfig has already been in the graph
+                    // (finally not by brute force! configs are indexed by their keys)
+                    int existConfigID = _FindPuzzleConfig(neighborConfig);
 
-                    _GraphEdges[newConfigID].insert(frontConfigID);
-                    _GraphEdges[frontConfigID].insert(newConfigID);
+                    if (existConfigID != -1) // if neighborConfig is already in the graph, find its ID
+                    {
+                        // the depth of that "already existing" config must be the same as or shallower than current config
+                        // no need to update the preceding node
+                        _GraphEdges.emplace_back(std::min(existConfigID, frontConfigID), std::max(existConfigID, frontConfigID));
+                    }
+                    else
+                    {
+                        int newConfigID = _AddPuzzleConfig(std::move(neighborConfig), frontConfigID, &_LiveStateArenas[(level + 1) % 3]);
 
-                    visit[newConfigID] = false;
+                        _GraphEdges.emplace_back(frontConfigID, newConfigID); // new configs always have larger IDs
 
-                    queue.push(newConfigID);
+                        nextFrontier.push_back(newConfigID);
+                    }
                 }
             }
         }
 
-        visit[frontConfigID] = true;
+        for (auto prevConfigID : prevFrontier)
+        {
+            _ReleaseLiveConfig(prevConfigID);
+        }
+        _LiveStateArenas[(level + 2) % 3].Clear(); // the previous level, compact storage only
+        prevFrontier = std::move(frontier);
+
+        LOG_INFO("Depth %d: expanded %d config(s) on %d thread(s), %zu new config(s)", currentDepth, expandedConfigNum,
+                 _ParallelBuild ? gThreadPool.GetThreadNum() : 1, nextFrontier.size());
+        _ReportProgress(expandedConfigNum, nextFrontier.size(), currentDepth + 1);
+        _CheckMemoryLimit();
+
+        frontier = std::move(nextFrontier);
+        level++;
+    }
+
+    for (auto prevConfigID : prevFrontier)
+    {
+        _ReleaseLiveConfig(prevConfigID);
+    }
+    _LiveConfigs.clear();
+    for (auto &liveStateArena : _LiveStateArenas)
+    {
+        liveStateArena.Clear();
+    }
+
+    _CompactGraphEdges(sortedEdgeNum);
+
+    if (_IsCancelRequested())
+    {
+        LOG_WARNING("The disassembly was cancelled, %d config(s) built so far", GetPuzzleConfigNum());
+        return false;
+    }
+
+    if (_SearchBudgetExceeded)
+    {
+        LOG_INFO("The search budget is exceeded, %d config(s) expanded", expandedNum);
+        return false;
+    }
+
+    if (_TargetNodeIDs.empty())
+    {
+        LOG_ERROR("This puzzle cannot be disassembled any further!");
+        return false;
     }
 
     _MinTargetNodeDepth = std::min(_MinTargetNodeDepth, currentMinTargetNodeDepth);
     _DisasmGraphBuilt = true;
 
+    LOG_INFO("Kernel disassembly graph: %d node(s), %.1f bytes per node", GetPuzzleConfigNum(), GetMemoryUsagePerNode());
+
     // extract the kernel disassembly plan from the root node to the shallowest target node
     std::stack<int> planStack;
     int currentNodeID = _TargetNodeIDs.begin()->second;
@@ -230,7 +591,9 @@ void DisassemblyGraph::BuildKernelDisassemblyGraph(int configID, int relativeDep
         planStack.pop();
     }
 
-    LOG_INFO("Extracted kernel disassembly plan. Plan size = %d", _DisassemblyPlan.size());
+    LOG_INFO("Extracted kernel disassembly plan. Plan size = %zu", _DisassemblyPlan.size());
+
+    return true;
 }
 
 void DisassemblyGraph::BuildCompleteDisassemblyGraph()
@@ -241,18 +604,163 @@ void DisassemblyGraph::BuildCompleteDisassemblyGraph()
     // 1. the meaning of "depth" should change, relative to the previous kernel disassembly graph's target node
     // 2. the criteria of "full config" should change, since every config after first kernel disassembling is not a full config
 
-    // for simplicity I didn't disassemble those removed subassembly, only disassemble the remaining parts.
+    // the removed subassemblies don't interact with the remaining parts any more
+    // so each of them is solved by its own graph in a task, while this thread goes on with the remaining parts
+    // (the sub-graphs do the same, the pool steals the tasks of the whole tree)
+    TaskGroup subassemblyTasks;
+
+    PROFILE_SCOPE("Solver: complete graph");
 
     // NOTE: always start from node #0
-    BuildKernelDisassemblyGraph();
-    auto prevTargetNode = _GraphNodes[_PrevTargetNodeID];
-    while (prevTargetNode->GetPuzzlePieceNum() != 1)
+    if (!BuildKernelDisassemblyGraph())
     {
-        BuildKernelDisassemblyGraph(_PrevTargetNodeID, prevTargetNode->GetDepth(), prevTargetNode->GetRemovedPieceNum());
-        prevTargetNode = _GraphNodes[_PrevTargetNodeID];
+        return;
     }
+    _DisassembleRemovedSubassembly(subassemblyTasks);
 
-    _DisasmGraphBuilt = true;
+    while (true)
+    {
+        // the graph grows while building (and may rebuild configs), so the previous target node is looked up by its ID every time
+        int depth = 0, removedPieceNum = 0;
+        {
+            std::lock_guard graphLock(_GraphMutex);
+            auto &prevTargetNode = GetPuzzleConfig(_PrevTargetNodeID);
+            if (prevTargetNode.GetPuzzlePieceNum() <= 1) // a puzzle of one piece is empty after its kernel
+            {
+                break;
+            }
+
+            depth = prevTargetNode.GetDepth();
+            removedPieceNum = prevTargetNode.GetRemovedPieceNum();
+        }
+
+        if (!BuildKernelDisassemblyGraph(_PrevTargetNodeID, depth, removedPieceNum))
+        {
+            break;
+        }
+        _DisassembleRemovedSubassembly(subassemblyTasks);
+    }
+
+    subassemblyTasks.Wait();
+    _DisasmGraphBuilt = !_IsCancelRequested();
+}
+
+void DisassemblyGraph::_DisassembleRemovedSubassembly(TaskGroup &subassemblyTasks)
+{
+    PieceMask subasmMask = _GraphNodesMoves[_PrevTargetNodeID]._SubasmMask;
+    if (subasmMask.GetPieceNum() <= 1)
+    {
+        return;
+    }
+
+    // the config may be rebuilt into the cache, so the pieces are copied here rather than in the task
+    std::lock_guard graphLock(_GraphMutex);
+    auto pieces = _MakeSubassemblyPieces(_PrevTargetNodeID);
+
+    auto &subassemblyPlan = _SubassemblyPlans.emplace_back();
+    subassemblyPlan._PlanOffset = _DisassemblyPlan.size() - 1;
+    subassemblyPlan._PieceMask = subasmMask;
+    subassemblyPlan._Graph = std::make_unique<DisassemblyGraph>();
+    subassemblyPlan._Graph->SetCompactStorage(_CompactStorage);
+    subassemblyPlan._Graph->SetParallelBuild(_ParallelBuild);
+    subassemblyPlan._Graph->_ParentGraph = this;
+
+    // the graph is owned by the plan entry, which may move when _SubassemblyPlans grows
+    subassemblyTasks.Run([graph = subassemblyPlan._Graph.get(), pieces = std::move(pieces)]() mutable {
+        if (graph->ImportPuzzle(std::move(pieces)))
+        {
+            graph->BuildCompleteDisassemblyGraph();
+        }
+    });
+}
+
+std::vector<PuzzlePiece> DisassemblyGraph::_MakeSubassemblyPieces(int targetNodeID)
+{
+    // the pieces of the subassembly as they are placed right before the removal
+    auto &config = GetPuzzleConfig(_GraphNodesParents[targetNodeID]);
+    std::vector<PuzzlePiece> pieces;
+    for (int pieceID : _GraphNodesMoves[targetNodeID]._SubasmMask)
+    {
+        auto &state = config.GetPieceState(pieceID);
+
+        auto &piece = pieces.emplace_back();
+        for (auto &voxel : _Geometry->_Pieces[pieceID]._Voxels)
+        {
+            piece._Voxels.emplace_back(voxel._X + state._OffsetX, voxel._Z + state._OffsetZ);
+        }
+    }
+
+    return pieces;
+}
+
+void DisassemblyGraph::CancelBuild()
+{
+    _CancelRequested = true;
+}
+
+DisassemblyGraph::BuildProgress DisassemblyGraph::GetBuildProgress() const
+{
+    std::lock_guard lock(_ProgressMutex);
+    return _Progress;
+}
+
+std::unique_lock<std::mutex> DisassemblyGraph::TryLockGraph()
+{
+    return std::unique_lock(_GraphMutex, std::try_to_lock);
+}
+
+bool DisassemblyGraph::_IsCancelRequested() const
+{
+    return _CancelRequested.load(std::memory_order_relaxed) || (_ParentGraph && _ParentGraph->_IsCancelRequested());
+}
+
+void DisassemblyGraph::_ReportProgress(int expandedNum, int frontierSize, int depth)
+{
+    {
+        std::lock_guard lock(_ProgressMutex);
+        _Progress._ExpandedNum += expandedNum;
+        _Progress._FrontierSize = frontierSize;
+        _Progress._Depth = depth;
+        _Progress._NodeNum = GetPuzzleConfigNum();
+        _Progress._PeakMemoryUsage = std::max(_Progress._PeakMemoryUsage, GetMemoryUsage());
+    }
+
+    // the expansions of the sub-graphs count for the whole puzzle
+    for (auto graph = _ParentGraph; graph && expandedNum; graph = graph->_ParentGraph)
+    {
+        std::lock_guard lock(graph->_ProgressMutex);
+        graph->_Progress._ExpandedNum += expandedNum;
+    }
+}
+
+bool DisassemblyGraph::_CheckMemoryLimit()
+{
+    auto rootGraph = this;
+    while (rootGraph->_ParentGraph)
+    {
+        rootGraph = rootGraph->_ParentGraph;
+    }
+
+    // the graphs of the tree grow (or shrink) at the same time, each adds its own change to the total on the root
+    // (unsigned: a shrink wraps around, the sum is still right)
+    std::size_t memoryUsage = GetMemoryUsage();
+    std::size_t change = memoryUsage - _CountedMemoryUsage;
+    std::size_t treeMemoryUsage = rootGraph->_TreeMemoryUsage.fetch_add(change) + change;
+    _CountedMemoryUsage = memoryUsage;
+
+    std::size_t memoryLimit = rootGraph->_MemoryLimit;
+    if (memoryLimit == 0 || treeMemoryUsage <= memoryLimit)
+    {
+        return true;
+    }
+
+    if (!rootGraph->_MemoryLimitExceeded.exchange(true))
+    {
+        LOG_WARNING("The memory limit is exceeded (%zu > %zu bytes), cancelling the disassembly", treeMemoryUsage, memoryLimit);
+    }
+    rootGraph->CancelBuild();
+
+    return false;
 }
 
 int DisassemblyGraph::GetDisasmPlanConfigID(int planOffset)
@@ -265,6 +773,16 @@ bool DisassemblyGraph::IsDisasmGraphBuilt() const
     return _DisasmGraphBuilt;
 }
 
+const std::string &DisassemblyGraph::GetImportError() const
+{
+    return _ImportError;
+}
+
+std::uint64_t DisassemblyGraph::GetPuzzleHash() const
+{
+    return _PuzzleHash;
+}
+
 int DisassemblyGraph::GetPuzzleDifficulty() const
 {
     return _MinTargetNodeDepth;
@@ -274,3 +792,43 @@ int DisassemblyGraph::GetDisasmPlanSize() const
 {
     return _DisassemblyPlan.size();
 }
+
+int DisassemblyGraph::GetSubassemblyPlanNum() const
+{
+    return _SubassemblyPlans.size();
+}
+
+DisassemblyGraph::SubassemblyPlan &DisassemblyGraph::GetSubassemblyPlan(int index)
+{
+    return _SubassemblyPlans[index];
+}
+
+std::size_t DisassemblyGraph::GetMemoryUsage() const
+{
+    // the nodes are stored in flat blocks, so this is exact up to the allocators' bookkeeping (the live configs are estimated)
+    // (the acceleration structures are transient and not included)
+    std::size_t usage = _GraphNodes.capacity() * sizeof(PuzzleConfig) + _StateArena.GetMemoryUsage();
+    usage += _GraphNodesParents.capacity() * sizeof(int);
+    usage += _GraphNodesMoves.capacity() * sizeof(PuzzleMove);
+    usage += _GraphNodesKeys.capacity() * sizeof(std::uint64_t);
+    usage += _GraphEdges.capacity() * sizeof(std::pair<int, int>);
+    usage += _GraphNodesIndex.capacity() * sizeof(int);
+
+    usage += _LiveConfigs.size() * (sizeof(std::pair<const int, PuzzleConfig>) + sizeof(void *)) +
+             _LiveConfigs.bucket_count() * sizeof(void *);
+    for (auto &liveStateArena : _LiveStateArenas)
+    {
+        usage += liveStateArena.GetMemoryUsage();
+    }
+    for (auto &entry : _ConfigCache)
+    {
+        usage += sizeof(entry) + entry._StateArena.GetMemoryUsage();
+    }
+
+    return usage;
+}
+
+double DisassemblyGraph::GetMemoryUsagePerNode() const
+{
+    return _GraphNodesParents.empty() ? 0.0 : static_cast<double>(GetMemoryUsage()) / _GraphNodesParents.size();
+}
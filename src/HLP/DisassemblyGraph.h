@@ -1,46 +1,169 @@
 #pragma once
 
+#include <cstdint>
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
-#include <unordered_set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "PuzzleConfig.h"
 
+class TaskGroup;
+
 class DisassemblyGraph
 {
 public:
-    // puzzle is either generated by the PuzzleGenerator or imported from a puzzle file
-    // all data will be cleared before each generation / import
+    // a subassembly removed by the complete disassembly plan, disassembled further by its own graph
+    struct SubassemblyPlan
+    {
+        int _PlanOffset = 0;      // the step of the plan which removes the subassembly
+        PieceMask _PieceMask;     // piece i of the sub-graph is the i-th set bit
+        std::unique_ptr<DisassemblyGraph> _Graph;
+    };
+
+    // a snapshot of the build, see GetBuildProgress
+    struct BuildProgress
+    {
+        int _ExpandedNum = 0;  // configs expanded so far, including the ones of the removed subassemblies
+        int _FrontierSize = 0; // of the current level
+        int _Depth = 0;        // of the current level
+        int _NodeNum = 0;
+        std::size_t _PeakMemoryUsage = 0; // in bytes, of this graph only (see GetMemoryUsage)
+    };
+
+    // puzzle is either generated by the PuzzleGenerator or imported from a puzzle file (text or binary, see PuzzleFile.h)
+    // all data will be cleared before each generation / import, the arenas are released as a whole
     bool ImportPuzzle(const std::string &puzzleFilePath);
+    bool ImportPuzzle(std::vector<PuzzlePiece> &&pieces);
+    const std::string &GetImportError() const; // why the last import failed, empty if it didn't
+
+    // compact storage: a node only keeps its parent, the move from the parent and its key
+    // full configs are kept only around the BFS frontier, the others are rebuilt on demand (into a small LRU cache)
+    // takes effect at the next import
+    void SetCompactStorage(bool compact);
+    bool IsCompactStorage() const;
+
+    // the build is cancelled once the graphs of the puzzle (this one and the sub-graphs) use more in total (0: no limit)
+    void SetMemoryLimit(std::size_t bytes);
+    bool IsMemoryLimitExceeded() const; // by the last build
+
+    // a kernel BFS gives up once the puzzle is known to be harder: no removal within maxDepth moves (relative to the start of
+    // the BFS), or more than maxExpandedNum configs expanded by it (0: no limit, for either), the sub-graphs have no budget
+    // e.g. for the generator, which only needs to know if a candidate is within its target difficulty
+    void SetSearchBudget(int maxDepth, int maxExpandedNum);
+    bool IsSearchBudgetExceeded() const; // by the last build
+
+    // the configs of a level are expanded on the thread pool (default) or on the calling thread only
+    // the latter is faster if the pool is busy anyway, e.g. building many graphs at the same time
+    void SetParallelBuild(bool parallel);
 
     // config operations
-    void RenderConfig(int configID, Shader &shader, VertexBuffer &voxelModel);
-    void CalculateNeighborConfigs(int configID, std::vector<std::shared_ptr<PuzzleConfig>> &neighborConfigs);
-    void BuildKernelDisassemblyGraph(int configID = 0, int relativeDepth = 0, int fullConfigDelta = 0);
+    void CalculateNeighborConfigs(int configID, std::vector<PuzzleConfig> &neighborConfigs, Arena<PuzzlePieceState> &stateArena);
+    // returns false if no subassembly can ever be removed from the config #configID
+    bool BuildKernelDisassemblyGraph(int configID = 0, int relativeDepth = 0, int fullConfigDelta = 0);
+    // every removed subassembly of more than one piece is an independent puzzle again
+    // they are disassembled recursively as tasks on the thread pool, concurrently with the remaining parts
     void BuildCompleteDisassemblyGraph();
     void DisassembleGraph();
 
+    // the build may run on another thread, the following functions are safe to call from any thread meanwhile
+    // the build returns as soon as the current level is expanded, leaving the graph built so far (import again to restart)
+    void CancelBuild();
+    BuildProgress GetBuildProgress() const;
+    // the builder only releases the graph while it expands a level, so don't wait for it (e.g. retry in the next frame)
+    // with the lock held, the queries below are safe on the partial graph
+    std::unique_lock<std::mutex> TryLockGraph();
+
     // queries
+    // with compact storage the config may be rebuilt into the cache, the reference is valid until cConfigCacheSize - 1 other configs are
     PuzzleConfig &GetPuzzleConfig(int configID);
     int GetDisasmPlanConfigID(int planOffset);
     int GetPuzzleConfigNum() const;
     int GetDisasmPlanSize() const;
+    int GetSubassemblyPlanNum() const; // only after BuildCompleteDisassemblyGraph, ordered by _PlanOffset
+    SubassemblyPlan &GetSubassemblyPlan(int index);
     bool IsDisasmGraphBuilt() const;
     int GetPuzzleDifficulty() const;
+    std::uint64_t GetPuzzleHash() const; // of the imported geometry, the key of the solution cache
+    std::size_t GetMemoryUsage() const; // in bytes, nodes + edges + index
+    double GetMemoryUsagePerNode() const;
 
     // tests
     void Test_AddAllNeighborConfigs(int configID); // this action doesn't maintain edges!
 
 private:
-    std::vector<std::unordered_set<int>> _GraphEdges;
-    std::vector<std::shared_ptr<PuzzleConfig>> _GraphNodes;
+    friend struct SolutionCacheAccess; // the solution cache stores / restores the built graph, see SolutionCache.cpp
+
+    // helpers
+    bool _ImportGeometry(std::unique_ptr<PuzzleGeometry> &&geometry); // the validation and the reset shared by the imports
+    int _FindPuzzleConfig(const PuzzleConfig &config); // returns -1 if the config is not in the graph
+    // the states are copied: to _StateArena, or with compact storage to liveStateArena (if not null, otherwise the config is dropped)
+    int _AddPuzzleConfig(PuzzleConfig &&config, int parentID, Arena<PuzzlePieceState> *liveStateArena = nullptr);
+    PuzzleConfig *_FindLiveConfig(int configID); // nullptr if the config is not stored in full right now
+    PuzzleConfig *_FindCachedConfig(int configID);
+    void _MakeLive(int configID, Arena<PuzzlePieceState> &liveStateArena);
+    void _ReleaseLiveConfig(int configID);
+    void _IndexPuzzleConfig(int configID);
+    void _RebuildGraphNodesIndex(std::size_t slotNum);
+    void _CompactGraphEdges(std::size_t sortedEdgeNum);
+    void _DisassembleRemovedSubassembly(TaskGroup &subassemblyTasks); // the one removed by the last kernel plan
+    std::vector<PuzzlePiece> _MakeSubassemblyPieces(int targetNodeID); // the subassembly removed to reach the target node
+    bool _IsCancelRequested() const;                                  // of this graph or of any graph it's a sub-graph of
+    void _ReportProgress(int expandedNum, int frontierSize, int depth);
+    bool _CheckMemoryLimit(); // of the whole tree, cancels the build of the whole puzzle if exceeded
+
+private:
+    std::unique_ptr<PuzzleGeometry> _Geometry; // shared by all configs of the imported puzzle
+    std::uint64_t _PuzzleHash = 0;
+    std::string _ImportError;
+    // nodes are referenced by ID only, so they are stored by value and their piece states live in one arena
+    // with compact storage, only the root is stored here
+    std::vector<PuzzleConfig> _GraphNodes;
+    Arena<PuzzlePieceState> _StateArena;
     std::vector<int> _GraphNodesParents;
+    std::vector<PuzzleMove> _GraphNodesMoves;
+    std::vector<std::uint64_t> _GraphNodesKeys;
+    std::vector<std::pair<int, int>> _GraphEdges; // <smaller ID, larger ID>, sorted and unique after each BFS
+    std::vector<int> _GraphNodesIndex;            // open addressing by the hash of config (linear probing), -1: empty slot
     std::map<int, int> _TargetNodeIDs; // <depth , ID>
     std::vector<int> _DisassemblyPlan;
 
     int _MinTargetNodeDepth = 0x3f3f3f3f;
     bool _DisasmGraphBuilt = false;
     int _PrevTargetNodeID = -1;
+    std::vector<SubassemblyPlan> _SubassemblyPlans;
+    DisassemblyGraph *_ParentGraph = nullptr; // set for the sub-graphs of removed subassemblies
+
+    // building on another thread
+    std::mutex _GraphMutex;
+    std::atomic<bool> _CancelRequested = false;
+    mutable std::mutex _ProgressMutex;
+    BuildProgress _Progress;
+    std::size_t _MemoryLimit = 0;                   // the one of the top-level graph holds for the whole tree
+    std::atomic<bool> _MemoryLimitExceeded = false; // set on the top-level graph
+    std::atomic<std::size_t> _TreeMemoryUsage = 0;  // on the top-level graph: of all graphs of the tree, as of their last check
+    std::size_t _CountedMemoryUsage = 0;            // the part of this graph in it
+    int _MaxSearchDepth = 0;
+    int _MaxExpandedNum = 0;
+    bool _SearchBudgetExceeded = false;
+    bool _ParallelBuild = true;
+
+    // compact storage
+    struct CachedConfig
+    {
+        int _ConfigID = -1;
+        std::uint64_t _LastUse = 0;
+        Arena<PuzzlePieceState> _StateArena;
+        PuzzleConfig _Config;
+    };
+
+    bool _CompactStorage = false;
+    std::unordered_map<int, PuzzleConfig> _LiveConfigs; // the previous, current and next level of the BFS
+    Arena<PuzzlePieceState> _LiveStateArenas[3];        // their states, indexed by (level of the BFS) % 3
+    std::vector<CachedConfig> _ConfigCache;             // LRU of the rebuilt configs
+    std::uint64_t _ConfigCacheClock = 0;
 };
@@ -1,6 +1,19 @@
 #pragma once
 
 constexpr int cPuzzleFileMagicNumber = 1717935966;
+// pieces are indexed by the bits of PieceMask, every 64 of them cost 8 bytes per graph node (twice: config and move)
+// build with a smaller HLP_MAX_PIECE_NUM (xmake f --max-pieces=64) if the puzzles are small and memory is tight
+#ifndef HLP_MAX_PIECE_NUM
+#define HLP_MAX_PIECE_NUM 256
+#endif
+constexpr int cMaxPieceNum = HLP_MAX_PIECE_NUM;
 constexpr const char *cPuzzleFileFolder = "resources";
 constexpr const char *cpBasicShaderVSPath = "shaders/basic.vs";
 constexpr const char *cpBasicShaderFSPath = "shaders/basic.fs";
+constexpr unsigned cCameraUniformBinding = 0; // layout(binding = ...) of the Camera uniform block in the shaders
+constexpr int cMeshCacheSize = 256; // the meshes of the rendered configs kept on the GPU
+constexpr int cConfigCacheSize = 16; // compact graph storage: the number of rebuilt configs kept
+constexpr int cSolutionFileMagicNumber = 1397508176;
+constexpr int cSolverVersion = 1; // bump it whenever the solver may build other graphs / plans, it invalidates the solution cache
+constexpr const char *cSolutionCacheFolder = "cache";
+constexpr int cGeneratorEliteNum = 64; // the candidates kept by the puzzle generator as the parents of its mutations
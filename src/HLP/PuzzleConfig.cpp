@@ -1,21 +1,29 @@
 #include "PuzzleConfig.h"
 
-#include <stack>
-
-#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <bit>
 
 #include "Logger.h"
 #include "Utils.h"
 
 int PuzzleConfig::_NoPiece = -1;
 int PuzzleConfig::_Inf = 0x3f3f3f3f;
+CollisionBackend PuzzleConfig::_CollisionBackend = CollisionBackend::BITBOARD;
 
 int PuzzleConfig::_DxArray[4] = {0, 0, -1, 1};
 int PuzzleConfig::_DzArray[4] = {-1, 1, 0, 0};
 const char *PuzzleConfig::_DirArray[4] = {"BACK", "FORWARD", "LEFT", "RIGHT"};
 
-PuzzleConfig::PuzzleConfig(int depth, int originalPieceNum) : _Depth(depth), _OriginalPieceNum(originalPieceNum)
+PuzzleConfig::PuzzleConfig(const PuzzleGeometry *geometry, int depth, Arena<PuzzlePieceState> &stateArena)
+    : _Geometry(geometry), _Depth(depth)
 {
+    int n = geometry->_Pieces.size();
+    _States = stateArena.Allocate(n);
+    std::fill(_States, _States + n, PuzzlePieceState{});
+    _PieceMask = PieceMask::FromRange(n);
+
+    _CalculateBoundingBox();
+    _CalculateHash();
 }
 
 int PuzzleConfig::GetDepth() const
@@ -25,92 +33,59 @@ int PuzzleConfig::GetDepth() const
 
 bool PuzzleConfig::IsFullConfig(int delta) const
 {
-    return _PieceIDs.size() + delta == _OriginalPieceNum;
+    return GetPuzzlePieceNum() + delta == _GetTotalPieceNum();
+}
+
+int PuzzleConfig::_GetTotalPieceNum() const
+{
+    return _Geometry->_Pieces.size();
 }
 
-void PuzzleConfig::AddPuzzlePiece(int pieceID, std::shared_ptr<PuzzlePiece> puzzlePiece)
+void PuzzleConfig::SetCollisionBackend(CollisionBackend backend)
 {
-    _Data[pieceID] = PuzzlePieceInfo(puzzlePiece);
-    _PieceIDs.push_back(pieceID);
+    _CollisionBackend = backend;
 }
 
-void PuzzleConfig::AddPuzzlePiece(int pieceID, std::shared_ptr<PuzzlePiece> puzzlePiece, const PuzzlePieceState &state)
+CollisionBackend PuzzleConfig::GetCollisionBackend()
 {
-    _Data[pieceID] = PuzzlePieceInfo(puzzlePiece, state);
-    _PieceIDs.push_back(pieceID);
+    return _CollisionBackend;
 }
 
-void PuzzleConfig::AddPuzzlePiece(int pieceID, const PuzzlePieceInfo &puzzlePieceInfo)
+bool PuzzleConfig::HasAccelStructures() const
 {
-    _Data[pieceID] = puzzlePieceInfo;
-    _PieceIDs.push_back(pieceID);
+    return _Accel != nullptr;
 }
 
-void PuzzleConfig::Render(Shader &shader, VertexBuffer &voxelModel)
+void PuzzleConfig::ReleaseAccelStructures()
 {
-    shader.Activate();
+    _Accel.reset();
+}
 
-    glm::vec3 pos{};
+void PuzzleConfig::TraverseOccupiedRuns(const std::function<void(int, int, int, int)> &callback)
+{
+    if (!_Accel)
+    {
+        BuildAccelStructures();
+    }
 
     for (int x = 0; x < _SizeX; x++)
     {
         int z = 0;
-        for (auto &run : _OccupiedRLEMapZ[x])
+        auto runs = _Accel->_OccupiedRLEMapZ.GetRuns(x);
+        for (int i = 0; i < _Accel->_OccupiedRLEMapZ.GetRunNum(x); i++)
         {
-            int pieceID = run._PieceID, length = run._Length;
-            if (pieceID != _NoPiece)
+            auto &run = runs[i];
+            if (run._PieceID != _NoPiece)
             {
-                for (int dz = 0; dz < length; dz++)
-                {
-                    glm::mat4 model(1.0f);
-                    pos = {x + _MinX, 0, z + dz + _MinZ}; // don't forget to map coordinates
-                    shader.SetUniform("model", glm::translate(model, pos));
-                    shader.SetUniform("color", _PuzzlePieceMaterialsMap[pieceID]._Color);
-                    voxelModel.DrawTriangles(0, 36);
-                }
+                callback(run._PieceID, x + _MinX, z + _MinZ, run._Length); // don't forget to map coordinates
             }
 
-            z += length;
+            z += run._Length;
         }
     }
 }
 
-void PuzzleConfig::SetPieceMaterial(int pieceID, const PuzzlePieceMaterial &material)
-{
-    _PuzzlePieceMaterialsMap[pieceID] = material;
-}
-
-void PuzzleConfig::AssignPuzzlePieceMaterials()
-{
-    auto GenerateRandomColor = []() {
-        static const std::vector<float> segments = {0, 0.4, 0.7, 1.0};
-        static const std::vector<int> weight = {1, 5, 1};
-
-        // FIXME: Why adding a static keyword here would cause access violation???
-        // and why adding this annotation making the issue solved?
-        // it must be the compiler's fault...
-        static std::vector<float> res(3);
-
-        RandPiecewiseDist(res, 3, segments, weight);
-
-        return glm::vec3(res[0], res[1], res[2]);
-    };
-
-    // 2024-06-13 UPD:
-    // originally I assigned different materials(colors) to adjacent pieces
-    // but I found it useless now
-    // because if you move some pieces and some of them which are not adjacent before will be adjacent
-    // but you can't re-assign colors for them (or everything will be confusing)
-    // new strategy: every puzzle a piece has different color
-
-    int n = _Data.size();
-    for (int i = 0; i < n; i++)
-    {
-        _PuzzlePieceMaterialsMap[_PieceIDs[i]] = PuzzlePieceMaterial(GenerateRandomColor());
-    }
-}
-
-void PuzzleConfig::_BuildAdjacencyGraph(std::vector<std::vector<int>> &occupiedMap)
+void PuzzleConfig::_BuildAdjacencyGraph(const std::vector<int> &occupiedMap)
 {
     // initially all pieces' coordinates are in [0, sizeX) x [0, sizeZ)
     // mapped coordinates are in [sizeX, 2 * sizeX) x [sizeZ, 2 * sizeZ)
@@ -120,17 +95,21 @@ void PuzzleConfig::_BuildAdjacencyGraph(std::vector<std::vector<int>> &occupiedM
     {
         for (int z = 0; z < _SizeZ; z++)
         {
-            if (occupiedMap[x][z] != _NoPiece)
+            int pieceID = occupiedMap[x * _SizeZ + z];
+            if (pieceID != _NoPiece)
             {
                 for (int d = 0; d < 4; d++)
                 {
                     int nx = x + _DxArray[d];
                     int nz = z + _DzArray[d];
-                    if (nx >= 0 && nx < _SizeX && nz >= 0 && nz < _SizeZ && occupiedMap[nx][nz] != _NoPiece &&
-                        occupiedMap[nx][nz] != occupiedMap[x][z])
+                    if (nx >= 0 && nx < _SizeX && nz >= 0 && nz < _SizeZ)
                     {
-                        _AdjacencyGraph[occupiedMap[x][z]].insert(occupiedMap[nx][nz]);
-                        _AdjacencyGraph[occupiedMap[nx][nz]].insert(occupiedMap[x][z]);
+                        int adjacentPiece = occupiedMap[nx * _SizeZ + nz];
+                        if (adjacentPiece != _NoPiece && adjacentPiece != pieceID)
+                        {
+                            _Accel->_AdjacencyGraph[pieceID].Add(adjacentPiece);
+                            _Accel->_AdjacencyGraph[adjacentPiece].Add(pieceID);
+                        }
                     }
                 }
             }
@@ -139,186 +118,227 @@ void PuzzleConfig::_BuildAdjacencyGraph(std::vector<std::vector<int>> &occupiedM
 
     DLOG_INFO("Adjacency graph building completed");
     DEBUG_SCOPE({
-        int n = _Data.size();
-        for (auto pieceID : pieceIDs)
+        for (int pieceID : _PieceMask)
         {
-            std::cout << pieceID << " ->";
-            for (auto &adjacentPiece : _AdjacencyGraph[pieceID])
+            std::string adjacentPieces;
+            for (int adjacentPiece : _Accel->_AdjacencyGraph[pieceID])
             {
-                std::cout << ' ' << adjacentPiece;
+                adjacentPieces += ' ' + std::to_string(adjacentPiece);
             }
-            std::cout << std::endl;
+            DLOG_INFO("%d ->%s", pieceID, adjacentPieces.c_str());
         }
     });
 }
 
-void PuzzleConfig::CalculateNeighborConfigs(std::vector<std::shared_ptr<PuzzleConfig>> &neighborConfigs)
+void PuzzleConfig::CalculateNeighborConfigs(std::vector<PuzzleConfig> &neighborConfigs, Arena<PuzzlePieceState> &stateArena)
+{
+    GenerateNeighborConfigs(stateArena, [&](PuzzleConfig &neighborConfig) {
+        neighborConfigs.push_back(std::move(neighborConfig));
+        return true;
+    });
+
+    LOG_INFO("Neighbor config calculation completed! Found %zu neighbor(s).", neighborConfigs.size());
+}
+
+void PuzzleConfig::GenerateNeighborConfigs(Arena<PuzzlePieceState> &stateArena, const std::function<bool(PuzzleConfig &)> &callback)
 {
-    // 0. build acceleration structure
-    _BuildSubassemblyValidater();
+    // 0. build acceleration structure (only for this call if they are missing)
+    bool temporaryAccel = !_Accel;
+    if (temporaryAccel)
+    {
+        BuildAccelStructures();
+    }
+
+    // subassemblies which can't be removed but can be moved, their moves are generated after all removals
+    struct MovableSubassembly
+    {
+        PieceMask _SubasmMask;
+        int _MaxMovableSteps[4];
+    };
+    std::vector<MovableSubassembly> movableSubassemblies;
 
     // 1. enumerate subassemblies
-    std::set<int> subasmPieceIDs;
-    _EnumerateSubassembly(0, subasmPieceIDs, [&]() {
-        DLOG_INFO("Found a valid subassembly!");
+    bool stopped = !_EnumerateSubassembly([&](PieceMask subasmMask) {
         DEBUG_SCOPE({
-            for (auto pieceID : subasmPieceIDs)
+            std::string pieces;
+            for (int pieceID : subasmMask)
             {
-                std::cout << '<' << pieceID << "> ";
+                pieces += '<' + std::to_string(pieceID) + "> ";
             }
-            std::cout << std::endl;
+            DLOG_INFO("Found a valid subassembly! %s", pieces.c_str());
         });
 
         // 2. calculate the max movable distance in each direction
+        MovableSubassembly movable = {subasmMask, {}};
+        bool canMove = false;
         for (int d = 0; d < 4; d++)
         {
-            int maxMovableSteps = _CalculateMaxMovableDistance(subasmPieceIDs, d);
+            int maxMovableSteps = _CalculateMaxMovableDistance(subasmMask, d);
 
             DLOG_INFO("MaxMovableSteps in direction %s: %d", _DirArray[d], maxMovableSteps);
 
             // 3.1 remove the subassembly and label it as a target node
             if (maxMovableSteps == _Inf)
             {
-                auto newConfig = neighborConfigs.emplace_back(std::make_shared<PuzzleConfig>(_Depth + 1, _OriginalPieceNum));
-
-                int n = _Data.size();
-                for (int i = 0; i < n; i++)
-                {
-                    if (!subasmPieceIDs.contains(_PieceIDs[i]))
-                    {
-                        newConfig->AddPuzzlePiece(_PieceIDs[i], _Data[_PieceIDs[i]]);
-                        newConfig->SetPieceMaterial(_PieceIDs[i], _PuzzlePieceMaterialsMap[_PieceIDs[i]]);
-                    }
-                }
-
-                newConfig->BuildAccelStructures();
-
-                return; // if a piece can be removed, we don't care how it's removed
+                // neighbors only copy the offsets, their acceleration structures are built when (and if) they are needed
+                auto newConfig = MakeNeighborConfig({subasmMask, 0, static_cast<std::int8_t>(d), true}, stateArena);
+                return callback(newConfig); // if a piece can be removed, we don't care how it's removed
             }
-            else // 3.2 for each unit distance, generate a neighborconfig
-            {
-                for (int dist = 1; dist <= maxMovableSteps; dist++)
-                {
-                    auto newConfig = neighborConfigs.emplace_back(std::make_shared<PuzzleConfig>(_Depth + 1, _OriginalPieceNum));
 
-                    int n = _Data.size();
-                    for (int i = 0; i < n; i++)
-                    {
-                        if (!subasmPieceIDs.contains(_PieceIDs[i]))
-                        {
-                            newConfig->AddPuzzlePiece(_PieceIDs[i], _Data[_PieceIDs[i]]);
-                        }
-                        else
-                        {
-                            auto state = _Data[_PieceIDs[i]]._State;
-                            state._OffsetX += _DxArray[d] * dist;
-                            state._OffsetZ += _DzArray[d] * dist;
+            movable._MaxMovableSteps[d] = maxMovableSteps;
+            canMove = canMove || maxMovableSteps > 0;
+        }
 
-                            newConfig->AddPuzzlePiece(_PieceIDs[i], _Data[_PieceIDs[i]]._Piece, state);
-                        }
+        if (canMove)
+        {
+            movableSubassemblies.push_back(movable);
+        }
 
-                        newConfig->SetPieceMaterial(_PieceIDs[i], _PuzzlePieceMaterialsMap[_PieceIDs[i]]);
-                    }
+        return true;
+    });
 
-                    newConfig->BuildAccelStructures();
-                }
+    // 3.2 for each unit distance, generate a neighborconfig
+    for (auto &movable : movableSubassemblies)
+    {
+        for (int d = 0; d < 4 && !stopped; d++)
+        {
+            for (int dist = 1; dist <= movable._MaxMovableSteps[d] && !stopped; dist++)
+            {
+                PuzzleMove move = {movable._SubasmMask, static_cast<std::int16_t>(dist), static_cast<std::int8_t>(d), false};
+                auto newConfig = MakeNeighborConfig(move, stateArena);
+                stopped = !callback(newConfig);
             }
         }
-    });
+    }
 
-    LOG_INFO("Neighbor config calculation completed! Found %d neighbor(s).", neighborConfigs.size());
+    if (temporaryAccel)
+    {
+        ReleaseAccelStructures();
+    }
 }
 
-void PuzzleConfig::_EnumerateSubassembly(int depth, std::set<int> &pieceIDs, const std::function<void()> &callback)
+PuzzleConfig PuzzleConfig::Clone(Arena<PuzzlePieceState> &stateArena) const
 {
-    // Normally enumeration on sets have exponential time complexity
-    // But through correct pruning we will never reach that upper limit! (i hope so)
+    // copy the compact state only (the key as well, moves update it), the acceleration structures are never shared
+    PuzzleConfig newConfig;
+    newConfig._Geometry = _Geometry;
+    newConfig._PieceMask = _PieceMask;
+    newConfig._LastMove = _LastMove;
+    newConfig._Depth = _Depth;
+    newConfig._MinX = _MinX;
+    newConfig._MinZ = _MinZ;
+    newConfig._SizeX = _SizeX;
+    newConfig._SizeZ = _SizeZ;
+    newConfig._Hash = _Hash;
+    newConfig._States = stateArena.Allocate(_GetTotalPieceNum());
+    std::copy(_States, _States + _GetTotalPieceNum(), newConfig._States);
+
+    return newConfig;
+}
 
-    if (pieceIDs.size() <= (_Data.size() + 1) / 2 && depth != 0)
+PuzzleConfig PuzzleConfig::MakeNeighborConfig(const PuzzleMove &move, Arena<PuzzlePieceState> &stateArena) const
+{
+    auto newConfig = Clone(stateArena);
+    newConfig.ApplyMove(move);
+
+    return newConfig;
+}
+
+void PuzzleConfig::ApplyMove(const PuzzleMove &move)
+{
+    _Accel.reset();
+
+    if (move._Removal)
     {
-        callback();
+        _RemoveSubassembly(move._SubasmMask);
     }
-
-    if (depth == _Data.size())
+    else
     {
-        return;
+        _MoveSubassembly(move._SubasmMask, _DxArray[move._Direction] * move._Distance, _DzArray[move._Direction] * move._Distance);
     }
 
-    for (int i = depth; i < _Data.size(); i++)
+    _CalculateBoundingBox();
+    _LastMove = move;
+    _Depth++;
+}
+
+void PuzzleConfig::RelocateStates(Arena<PuzzlePieceState> &stateArena)
+{
+    int n = _GetTotalPieceNum();
+    auto states = stateArena.Allocate(n);
+    std::copy(_States, _States + n, states);
+    _States = states;
+}
+
+bool PuzzleConfig::_EnumerateSubassembly(const std::function<bool(PieceMask)> &callback)
+{
+    // Normally enumeration on sets have exponential time complexity
+    // But through correct pruning we will never reach that upper limit! (i hope so)
+
+    // only connected subassemblies are enumerated, each of them is rooted at its piece with the smallest ID
+    // pieces with smaller IDs are excluded, so that no subassembly is visited twice
+    int maxPieceNum = (GetPuzzlePieceNum() + 1) / 2;
+
+    for (int rootPieceID : _PieceMask)
     {
-        bool connected =
-            (pieceIDs.size() == 0) ? true : (_SubasmValidator.Find(_PieceIDs[i]) == _SubasmValidator.Find(_PieceIDs[depth - 1]));
-        if (connected) // make sure the newly visited piece is "connected" to previous pieces
+        PieceMask rootMask = PieceMask::FromPiece(rootPieceID);
+        PieceMask excludedMask = PieceMask::FromRange(rootPieceID + 1);
+        if (!_EnumerateSubassembly(rootMask, _Accel->_AdjacencyGraph[rootPieceID] & ~excludedMask, excludedMask, maxPieceNum, callback))
         {
-            pieceIDs.insert(_PieceIDs[i]);
-            _EnumerateSubassembly(i + 1, pieceIDs, callback);
-            pieceIDs.erase(_PieceIDs[i]);
+            return false;
         }
     }
+
+    return true;
 }
 
-bool PuzzleConfig::_ValidateSubassembly(std::set<int> &pieceIDs)
+bool PuzzleConfig::_EnumerateSubassembly(PieceMask subasmMask, PieceMask extensionMask, PieceMask excludedMask, int maxPieceNum,
+                                         const std::function<bool(PieceMask)> &callback)
 {
-    // ! deprecated !
-    // since I found a better approach: use Disjoint Set Union
+    // extensionMask: pieces adjacent to the subassembly that may still be added
+    // excludedMask: pieces that must not be added in this branch
+    // each extension piece is either added (recursion) or excluded (loop), so every subassembly is reached on exactly one path
+    // time complexity: O(pieceNum) per subassembly, no allocations at all
 
-    // do a DFS from the first element on the _AdjacencyGraph
-    // check if every element can be visited
-    // time complexity: O(pieceIDs.size())
-
-    if (pieceIDs.empty())
+    if (!callback(subasmMask))
     {
         return false;
     }
 
-    std::vector<std::uint8_t> vis(_Data.size());
-    std::stack<int> visStack;
-    int visCount = 0;
-
-    // stuck here for a while because of the positioning of vis[..] = 1
-    // now I got it:
-    // when you try to use stack / queue to realize DFS / BFS
-    // FIRST consider their recursive form!
-
-    visStack.push(*pieceIDs.begin());
-    vis[*pieceIDs.begin()] = 1;
-
-    while (!visStack.empty())
+    if (subasmMask.GetPieceNum() == maxPieceNum)
     {
-        auto topPiece = visStack.top();
-        visStack.pop();
+        return true;
+    }
 
-        ++visCount;
+    while (extensionMask)
+    {
+        int pieceID = extensionMask.GetFirstPiece();
+        PieceMask pieceMask = PieceMask::FromPiece(pieceID);
+        extensionMask ^= pieceMask;
+        excludedMask |= pieceMask;
 
-        for (auto adjacentPiece : _AdjacencyGraph[topPiece])
+        PieceMask newExtensionMask = extensionMask | (_Accel->_AdjacencyGraph[pieceID] & ~excludedMask & ~subasmMask);
+        if (!_EnumerateSubassembly(subasmMask | pieceMask, newExtensionMask, excludedMask, maxPieceNum, callback))
         {
-            if (pieceIDs.contains(adjacentPiece) && !vis[adjacentPiece])
-            {
-                vis[adjacentPiece] = 1;
-                visStack.push(adjacentPiece);
-            }
+            return false;
         }
     }
 
-    return visCount == pieceIDs.size();
+    return true;
 }
 
-void PuzzleConfig::_BuildSubassemblyValidater()
+int PuzzleConfig::_CalculateMaxMovableDistance(PieceMask subasmMask, int direction)
 {
-    int n = _Data.size();
-
-    _SubasmValidator.Init(_PieceIDs.back() + 1); // TODO: optimize it! some space is wasted!
-
-    for (int i = 0; i < n; i++)
+    // the bitboards are only built if they are selected and the puzzle fits in them
+    if (!_Accel->_OccupiedRowBits.empty())
     {
-        for (auto adjacentPiece : _AdjacencyGraph[_PieceIDs[i]])
-        {
-            _SubasmValidator.Unite(_PieceIDs[i], adjacentPiece);
-        }
+        return _CalculateMaxMovableDistanceBitboard(subasmMask, direction);
     }
+
+    return _CalculateMaxMovableDistanceRLE(subasmMask, direction);
 }
 
-int PuzzleConfig::_CalculateMaxMovableDistance(std::set<int> &pieceIDs, int direction)
+int PuzzleConfig::_CalculateMaxMovableDistanceRLE(PieceMask subasmMask, int direction)
 {
     // stuck at here for two days
     // I am too dumb to figure this out..but eventually did it!
@@ -335,32 +355,36 @@ int PuzzleConfig::_CalculateMaxMovableDistance(std::set<int> &pieceIDs, int dire
     bool removable = true;
 
     // we can check the max movable distance of each voxel in the subassembly
-    for (auto pieceID : pieceIDs)
+    auto &rleMapX = _Accel->_OccupiedRLEMapX;
+    auto &rleMapZ = _Accel->_OccupiedRLEMapZ;
+
+    for (int pieceID : subasmMask)
     {
-        auto &[piece, state] = _Data[pieceID];
-        for (auto &voxel : piece->_Voxels)
+        auto &piece = _Geometry->_Pieces[pieceID];
+        auto &state = _States[pieceID];
+        for (auto &voxel : piece._Voxels)
         {
             int x = voxel._X + state._OffsetX - _MinX;
             int z = voxel._Z + state._OffsetZ - _MinZ;
             if (dx != 0)
             {
                 // first locate the piece in RLEMap
-                int RLEMapXSize_Z = _OccupiedRLEMapX[z].size();
-                int offset =
-                    std::upper_bound(_OccupiedRLEMapPreX[z].begin(), _OccupiedRLEMapPreX[z].end(), x) - _OccupiedRLEMapPreX[z].begin() - 1;
+                auto runs = rleMapX.GetRuns(z);
+                auto runsPre = rleMapX.GetRunsPre(z);
+                int RLEMapXSize_Z = rleMapX.GetRunNum(z);
+                int offset = std::upper_bound(runsPre, runsPre + RLEMapXSize_Z + 1, x) - runsPre - 1;
 
                 while (offset >= 0 && offset < RLEMapXSize_Z)
                 {
-                    int pieceIDCheck = _OccupiedRLEMapX[z][offset]._PieceID;
+                    int pieceIDCheck = runs[offset]._PieceID;
 
-                    if (pieceIDCheck != _NoPiece && !pieceIDs.contains(pieceIDCheck))
+                    if (pieceIDCheck != _NoPiece && !subasmMask.Contains(pieceIDCheck))
                     {
-                        int blockCoord =
-                            _OccupiedRLEMapPreX[z][offset + 1] -
-                            _OccupiedRLEMapX[z][offset]._Length; // coordinate of the first voxel that blocks the way of current voxel
+                        // coordinate of the first voxel that blocks the way of current voxel
+                        int blockCoord = runsPre[offset + 1] - runs[offset]._Length;
                         if (dx < 0)
                         {
-                            blockCoord = _OccupiedRLEMapPreX[z][offset + 1] - 1;
+                            blockCoord = runsPre[offset + 1] - 1;
                         }
                         maxMovableDistance = std::min(maxMovableDistance, std::abs(x - blockCoord) - 1);
                         removable = false;
@@ -372,20 +396,21 @@ int PuzzleConfig::_CalculateMaxMovableDistance(std::set<int> &pieceIDs, int dire
             }
             else // dz != 0, similar
             {
-                int RLEMapZSize_X = _OccupiedRLEMapZ[x].size();
-                int offset =
-                    std::upper_bound(_OccupiedRLEMapPreZ[x].begin(), _OccupiedRLEMapPreZ[x].end(), z) - _OccupiedRLEMapPreZ[x].begin() - 1;
+                auto runs = rleMapZ.GetRuns(x);
+                auto runsPre = rleMapZ.GetRunsPre(x);
+                int RLEMapZSize_X = rleMapZ.GetRunNum(x);
+                int offset = std::upper_bound(runsPre, runsPre + RLEMapZSize_X + 1, z) - runsPre - 1;
 
                 while (offset >= 0 && offset < RLEMapZSize_X)
                 {
-                    int pieceIDCheck = _OccupiedRLEMapZ[x][offset]._PieceID;
+                    int pieceIDCheck = runs[offset]._PieceID;
 
-                    if (pieceIDCheck != _NoPiece && !pieceIDs.contains(pieceIDCheck))
+                    if (pieceIDCheck != _NoPiece && !subasmMask.Contains(pieceIDCheck))
                     {
-                        int blockCoord = _OccupiedRLEMapPreZ[x][offset + 1] - _OccupiedRLEMapZ[x][offset]._Length;
+                        int blockCoord = runsPre[offset + 1] - runs[offset]._Length;
                         if (dz < 0)
                         {
-                            blockCoord = _OccupiedRLEMapPreZ[x][offset + 1] - 1;
+                            blockCoord = runsPre[offset + 1] - 1;
                         }
                         maxMovableDistance = std::min(maxMovableDistance, std::abs(z - blockCoord) - 1);
                         removable = false;
@@ -401,136 +426,254 @@ int PuzzleConfig::_CalculateMaxMovableDistance(std::set<int> &pieceIDs, int dire
     return removable ? _Inf : maxMovableDistance;
 }
 
+int PuzzleConfig::_CalculateMaxMovableDistanceBitboard(PieceMask subasmMask, int direction)
+{
+    // same idea as the RLE version, but a whole row (or column) is tested at once:
+    // only the front voxel of each run of the subassembly (in the moving direction) can hit something first,
+    // and the distance to the nearest blocker is a bit scan away
+    // time complexity: O(lines * runs per line)
+
+    auto &accel = *_Accel;
+
+    if (accel._SubasmMask != subasmMask)
+    {
+        // plain loops over contiguous words, compilers vectorize them
+        std::fill(accel._SubasmRowBits.begin(), accel._SubasmRowBits.end(), 0);
+        std::fill(accel._SubasmColumnBits.begin(), accel._SubasmColumnBits.end(), 0);
+        for (int pieceID : subasmMask)
+        {
+            auto pieceRows = accel._PieceRowBits.data() + pieceID * _SizeZ;
+            auto pieceColumns = accel._PieceColumnBits.data() + pieceID * _SizeX;
+            for (int z = 0; z < _SizeZ; z++)
+            {
+                accel._SubasmRowBits[z] |= pieceRows[z];
+            }
+            for (int x = 0; x < _SizeX; x++)
+            {
+                accel._SubasmColumnBits[x] |= pieceColumns[x];
+            }
+        }
+        accel._SubasmMask = subasmMask;
+    }
+
+    bool alongX = (_DxArray[direction] != 0);
+    bool positive = (_DxArray[direction] + _DzArray[direction] > 0);
+    int lineNum = alongX ? _SizeZ : _SizeX;
+    auto &subasmLines = alongX ? accel._SubasmRowBits : accel._SubasmColumnBits;
+    auto &occupiedLines = alongX ? accel._OccupiedRowBits : accel._OccupiedColumnBits;
+
+    int maxMovableDistance = _Inf;
+    for (int i = 0; i < lineNum; i++)
+    {
+        std::uint64_t subasm = subasmLines[i];
+        std::uint64_t others = occupiedLines[i] & ~subasm;
+        if (subasm == 0 || others == 0)
+        {
+            continue;
+        }
+
+        if (positive)
+        {
+            // bit p is a front iff p is in the subassembly and p + 1 is not
+            for (auto fronts = subasm & ~(subasm >> 1); fronts; fronts &= fronts - 1)
+            {
+                int p = std::countr_zero(fronts);
+                std::uint64_t blockers = (p == 63) ? 0 : (others >> (p + 1));
+                if (blockers)
+                {
+                    maxMovableDistance = std::min(maxMovableDistance, std::countr_zero(blockers));
+                }
+            }
+        }
+        else
+        {
+            for (auto fronts = subasm & ~(subasm << 1); fronts; fronts &= fronts - 1)
+            {
+                int p = std::countr_zero(fronts);
+                std::uint64_t blockers = others & ((std::uint64_t(1) << p) - 1);
+                if (blockers)
+                {
+                    maxMovableDistance = std::min(maxMovableDistance, p - 1 - (63 - std::countl_zero(blockers)));
+                }
+            }
+        }
+    }
+
+    return maxMovableDistance; // _Inf if nothing blocks the way, i.e. the subassembly is removable
+}
+
 void PuzzleConfig::_CalculateBoundingBox()
 {
+    // the bounding boxes of the pieces are precomputed, so only O(pieceNum) here
+    int maxX = -_Inf, maxZ = -_Inf;
     _MinX = _Inf;
     _MinZ = _Inf;
-    _MaxX = -_Inf;
-    _MaxZ = -_Inf;
 
-    for (auto &[pieceID, info] : _Data)
+    for (int pieceID : _PieceMask)
     {
-        auto &[piece, state] = info;
-        for (auto &voxel : piece->_Voxels)
-        {
-            int x = voxel._X + state._OffsetX;
-            int z = voxel._Z + state._OffsetZ;
+        auto &piece = _Geometry->_Pieces[pieceID];
+        auto &state = _States[pieceID];
 
-            _MinX = std::min(_MinX, x);
-            _MinZ = std::min(_MinZ, z);
-            _MaxX = std::max(_MaxX, x);
-            _MaxZ = std::max(_MaxZ, z);
-        }
+        _MinX = std::min(_MinX, piece._MinX + state._OffsetX);
+        _MinZ = std::min(_MinZ, piece._MinZ + state._OffsetZ);
+        maxX = std::max(maxX, piece._MaxX + state._OffsetX);
+        maxZ = std::max(maxZ, piece._MaxZ + state._OffsetZ);
     }
 
-    _SizeX = _MaxX - _MinX + 1;
-    _SizeZ = _MaxZ - _MinZ + 1;
+    _SizeX = maxX - _MinX + 1;
+    _SizeZ = maxZ - _MinZ + 1;
 }
 
-void PuzzleConfig::_BuildOccupiedRLEMap(std::vector<std::vector<int>> &occupiedMap)
+void PuzzleConfig::RLEMap::Init(int lineNum, int lineLength)
 {
-    _OccupiedRLEMapX.resize(_SizeZ);
-    _OccupiedRLEMapPreX.resize(_SizeZ);
-    for (int z = 0; z < _SizeZ; z++)
+    _LineLength = lineLength;
+    _Runs.resize(lineNum * lineLength);
+    _RunsPre.resize(lineNum * (lineLength + 1));
+    _RunNums.resize(lineNum);
+}
+
+int PuzzleConfig::RLEMap::GetRunNum(int line) const
+{
+    return _RunNums[line];
+}
+
+PuzzleConfig::RLEInfo *PuzzleConfig::RLEMap::GetRuns(int line)
+{
+    return _Runs.data() + line * _LineLength;
+}
+
+const PuzzleConfig::RLEInfo *PuzzleConfig::RLEMap::GetRuns(int line) const
+{
+    return _Runs.data() + line * _LineLength;
+}
+
+int *PuzzleConfig::RLEMap::GetRunsPre(int line)
+{
+    return _RunsPre.data() + line * (_LineLength + 1);
+}
+
+const int *PuzzleConfig::RLEMap::GetRunsPre(int line) const
+{
+    return _RunsPre.data() + line * (_LineLength + 1);
+}
+
+void PuzzleConfig::RLEMap::EncodeLine(int line, const int *cells)
+{
+    auto runs = GetRuns(line);
+    int n = 0;
+
+    int prev = 0;
+    for (int i = 1; i < _LineLength; i++)
     {
-        int prev = 0;
-        for (int x = 1; x < _SizeX; x++)
+        if (cells[i - 1] != cells[i])
         {
-            if (occupiedMap[x - 1][z] != occupiedMap[x][z])
-            {
-                _OccupiedRLEMapX[z].push_back({occupiedMap[x - 1][z], x - prev});
-                prev = x;
-            }
+            runs[n++] = {cells[i - 1], i - prev};
+            prev = i;
         }
+    }
+
+    // process the last segment
+    runs[n++] = {cells[prev], _LineLength - prev};
 
-        // process the last segment
-        _OccupiedRLEMapX[z].push_back({occupiedMap[prev][z], _SizeX - prev});
+    auto runsPre = GetRunsPre(line);
+    runsPre[0] = 0;
+    for (int i = 0; i < n; i++)
+    {
+        runsPre[i + 1] = runsPre[i] + runs[i]._Length;
+    }
+    _RunNums[line] = n;
+}
 
-        int n = _OccupiedRLEMapX[z].size();
-        _OccupiedRLEMapPreX[z].resize(n + 1);
-        for (int i = 0; i < n; i++)
+void PuzzleConfig::RLEMap::DecodeLine(int line, int *cells) const
+{
+    auto runs = GetRuns(line);
+    for (int i = 0; i < _RunNums[line]; i++)
+    {
+        std::fill(cells, cells + runs[i]._Length, runs[i]._PieceID);
+        cells += runs[i]._Length;
+    }
+}
+
+std::size_t PuzzleConfig::RLEMap::GetMemoryUsage() const
+{
+    return _Runs.capacity() * sizeof(RLEInfo) + (_RunsPre.capacity() + _RunNums.capacity()) * sizeof(int);
+}
+
+void PuzzleConfig::_BuildOccupiedRLEMap(const std::vector<int> &occupiedMap)
+{
+    auto &accel = *_Accel;
+
+    std::vector<int> line(_SizeX);
+
+    accel._OccupiedRLEMapX.Init(_SizeZ, _SizeX);
+    for (int z = 0; z < _SizeZ; z++)
+    {
+        for (int x = 0; x < _SizeX; x++)
         {
-            _OccupiedRLEMapPreX[z][i + 1] = _OccupiedRLEMapPreX[z][i] + _OccupiedRLEMapX[z][i]._Length;
+            line[x] = occupiedMap[x * _SizeZ + z];
         }
+        accel._OccupiedRLEMapX.EncodeLine(z, line.data());
 
-        DLOG_INFO("Constructed _OccupiedRLEMapX[%d]:", z);
         DEBUG_SCOPE({
-            for (auto &run : _OccupiedRLEMapX[z])
+            std::string runsText; // one declaration per line, a comma would split the macro argument
+            std::string runsPreText;
+            auto runs = accel._OccupiedRLEMapX.GetRuns(z);
+            auto runsPre = accel._OccupiedRLEMapX.GetRunsPre(z);
+            for (int i = 0; i < accel._OccupiedRLEMapX.GetRunNum(z); i++)
             {
-                std::cout << std::format("<{}, {}> ", run._PieceID, run._Length);
+                runsText += std::format("<{}, {}> ", runs[i]._PieceID, runs[i]._Length);
             }
-            std::cout << std::endl;
-        });
-
-        DLOG_INFO("Constructed _OccupiedRLEMapPreX[%d]:", z);
-        DEBUG_SCOPE({
-            for (auto &val : _OccupiedRLEMapPreX[z])
+            for (int i = 0; i <= accel._OccupiedRLEMapX.GetRunNum(z); i++)
             {
-                std::cout << val << ' ';
+                runsPreText += std::to_string(runsPre[i]) + ' ';
             }
-            std::cout << std::endl;
+            DLOG_INFO("Constructed _OccupiedRLEMapX[%d]: %s", z, runsText.c_str());
+            DLOG_INFO("Constructed _OccupiedRLEMapPreX[%d]: %s", z, runsPreText.c_str());
         });
     }
 
-    // similar
-    _OccupiedRLEMapZ.resize(_SizeX);
-    _OccupiedRLEMapPreZ.resize(_SizeX);
+    // similar, but the columns are already contiguous in occupiedMap
+    accel._OccupiedRLEMapZ.Init(_SizeX, _SizeZ);
     for (int x = 0; x < _SizeX; x++)
     {
-        int prev = 0;
-        for (int z = 1; z < _SizeZ; z++)
-        {
-            if (occupiedMap[x][z - 1] != occupiedMap[x][z])
-            {
-                _OccupiedRLEMapZ[x].push_back({occupiedMap[x][z - 1], z - prev});
-                prev = z;
-            }
-        }
+        accel._OccupiedRLEMapZ.EncodeLine(x, occupiedMap.data() + x * _SizeZ);
 
-        // process the last segment
-        _OccupiedRLEMapZ[x].push_back({occupiedMap[x][prev], _SizeZ - prev});
-
-        int n = _OccupiedRLEMapZ[x].size();
-        _OccupiedRLEMapPreZ[x].resize(n + 1);
-        for (int i = 0; i < n; i++)
-        {
-            _OccupiedRLEMapPreZ[x][i + 1] = _OccupiedRLEMapPreZ[x][i] + _OccupiedRLEMapZ[x][i]._Length;
-        }
-
-        DLOG_INFO("Constructed _OccupiedRLEMapZ[%d]:", x);
         DEBUG_SCOPE({
-            for (auto &run : _OccupiedRLEMapZ[x])
+            std::string runsText; // one declaration per line, a comma would split the macro argument
+            std::string runsPreText;
+            auto runs = accel._OccupiedRLEMapZ.GetRuns(x);
+            auto runsPre = accel._OccupiedRLEMapZ.GetRunsPre(x);
+            for (int i = 0; i < accel._OccupiedRLEMapZ.GetRunNum(x); i++)
             {
-                std::cout << std::format("<{}, {}> ", run._PieceID, run._Length);
+                runsText += std::format("<{}, {}> ", runs[i]._PieceID, runs[i]._Length);
             }
-            std::cout << std::endl;
-        });
-
-        DLOG_INFO("Constructed _OccupiedRLEMapPreZ[%d]:", x);
-        DEBUG_SCOPE({
-            for (auto &val : _OccupiedRLEMapPreZ[x])
+            for (int i = 0; i <= accel._OccupiedRLEMapZ.GetRunNum(x); i++)
             {
-                std::cout << val << ' ';
+                runsPreText += std::to_string(runsPre[i]) + ' ';
             }
-            std::cout << std::endl;
+            DLOG_INFO("Constructed _OccupiedRLEMapZ[%d]: %s", x, runsText.c_str());
+            DLOG_INFO("Constructed _OccupiedRLEMapPreZ[%d]: %s", x, runsPreText.c_str());
         });
     }
 }
 
 void PuzzleConfig::BuildAccelStructures()
 {
-    _CalculateBoundingBox();
+    _Accel = std::make_unique<AccelStructures>();
+    _Accel->_AdjacencyGraph.resize(_GetTotalPieceNum());
 
-    std::vector<std::vector<int>> occupiedMap(_SizeX, std::vector<int>(_SizeZ, _NoPiece));
-    for (auto &[pieceID, info] : _Data)
+    std::vector<int> occupiedMap(_SizeX * _SizeZ, _NoPiece); // [x * _SizeZ + z]
+    for (int pieceID : _PieceMask)
     {
-        auto &[piece, state] = info;
-        for (auto &voxel : piece->_Voxels)
+        auto &piece = _Geometry->_Pieces[pieceID];
+        auto &state = _States[pieceID];
+
+        for (auto &voxel : piece._Voxels)
         {
             // coordinates need to be mapped!
             int x = voxel._X + state._OffsetX - _MinX;
             int z = voxel._Z + state._OffsetZ - _MinZ;
-            occupiedMap[x][z] = pieceID;
+            occupiedMap[x * _SizeZ + z] = pieceID;
         }
     }
 
@@ -543,6 +686,221 @@ void PuzzleConfig::BuildAccelStructures()
     // adjacency graph is used to facilitate:
     // 1. subassembly enumeration
     _BuildAdjacencyGraph(occupiedMap);
+
+    // bitboards replace the rle map in collision checks if possible
+    if (_CollisionBackend == CollisionBackend::BITBOARD && _SizeX <= 64 && _SizeZ <= 64)
+    {
+        _BuildOccupiedBitboards(occupiedMap);
+    }
+}
+
+void PuzzleConfig::DeriveAccelStructures(const PuzzleConfig &parent)
+{
+    PieceMask movedMask;
+    for (int pieceID : _PieceMask)
+    {
+        if (!(_States[pieceID] == parent._States[pieceID]))
+        {
+            movedMask.Add(pieceID);
+        }
+    }
+
+    // this config is parent with the pieces in movedMask translated by the same (dx, dz)
+    // so only the lines covered by those pieces (before or after moving) differ from the parent's structures:
+    // the new content of line i is the parent's line i minus the moved pieces, plus the moved pieces of line (i - delta) shifted
+    // time complexity: O(touched lines * line length + copying the parent's structures)
+
+    // all coordinates in the structures are relative to the bounding box, if it changed, every line is touched anyway
+    if (!parent._Accel || _PieceMask != parent._PieceMask || !movedMask || _MinX != parent._MinX || _MinZ != parent._MinZ ||
+        _SizeX != parent._SizeX || _SizeZ != parent._SizeZ)
+    {
+        BuildAccelStructures();
+        return;
+    }
+
+    _Accel = std::make_unique<AccelStructures>(*parent._Accel);
+    auto &accel = *_Accel;
+    auto &parentAccel = *parent._Accel;
+
+    int firstPieceID = movedMask.GetFirstPiece();
+    int dx = _States[firstPieceID]._OffsetX - parent._States[firstPieceID]._OffsetX;
+    int dz = _States[firstPieceID]._OffsetZ - parent._States[firstPieceID]._OffsetZ;
+
+    // 1. find the touched lines through the bounding boxes of the moved pieces
+    std::vector<std::uint8_t> touchedRows(_SizeZ), touchedColumns(_SizeX);
+    for (int pieceID : movedMask)
+    {
+        auto &piece = _Geometry->_Pieces[pieceID];
+        auto &state = parent._States[pieceID];
+
+        for (int z = piece._MinZ + state._OffsetZ - _MinZ; z <= piece._MaxZ + state._OffsetZ - _MinZ; z++)
+        {
+            touchedRows[z] = touchedRows[z + dz] = 1;
+        }
+        for (int x = piece._MinX + state._OffsetX - _MinX; x <= piece._MaxX + state._OffsetX - _MinX; x++)
+        {
+            touchedColumns[x] = touchedColumns[x + dx] = 1;
+        }
+    }
+
+    // 2. patch the touched lines, then re-encode them
+    auto IsMoved = [&](int pieceID) {
+        return pieceID != _NoPiece && movedMask.Contains(pieceID);
+    };
+
+    auto PatchLine = [&](const RLEMap &parentLines, int i, int lineNum, int lineDelta, int shift, std::vector<int> &line,
+                         std::vector<int> &sourceLine) {
+        int length = parentLines._LineLength;
+
+        parentLines.DecodeLine(i, line.data());
+        for (int j = 0; j < length; j++)
+        {
+            if (IsMoved(line[j]))
+            {
+                line[j] = _NoPiece;
+            }
+        }
+
+        int source = i - lineDelta;
+        if (source >= 0 && source < lineNum)
+        {
+            parentLines.DecodeLine(source, sourceLine.data());
+            for (int j = 0; j < length; j++)
+            {
+                if (IsMoved(sourceLine[j]))
+                {
+                    line[j + shift] = sourceLine[j]; // the move is collision-free, so the target is inside the box and empty
+                }
+            }
+        }
+    };
+
+    // moved pieces lose all their contacts, which are found again in the touched lines (3.)
+    for (auto &adjacentMask : accel._AdjacencyGraph)
+    {
+        adjacentMask &= ~movedMask;
+    }
+    for (int pieceID : movedMask)
+    {
+        accel._AdjacencyGraph[pieceID] = PieceMask();
+    }
+
+    auto AddContacts = [&](const RLEMap &lines, int i) {
+        // two consecutive runs of different pieces are in contact
+        auto runs = lines.GetRuns(i);
+        for (int j = 1; j < lines.GetRunNum(i); j++)
+        {
+            int pieceA = runs[j - 1]._PieceID, pieceB = runs[j]._PieceID;
+            if (pieceA != _NoPiece && pieceB != _NoPiece && (IsMoved(pieceA) || IsMoved(pieceB)))
+            {
+                accel._AdjacencyGraph[pieceA].Add(pieceB);
+                accel._AdjacencyGraph[pieceB].Add(pieceA);
+            }
+        }
+    };
+
+    bool hasBitboards = !accel._OccupiedRowBits.empty();
+    std::vector<int> line(std::max(_SizeX, _SizeZ)), sourceLine(std::max(_SizeX, _SizeZ));
+
+    for (int z = 0; z < _SizeZ; z++)
+    {
+        if (touchedRows[z])
+        {
+            PatchLine(parentAccel._OccupiedRLEMapX, z, _SizeZ, dz, dx, line, sourceLine);
+            accel._OccupiedRLEMapX.EncodeLine(z, line.data());
+
+            // 3. contacts along x
+            AddContacts(accel._OccupiedRLEMapX, z);
+
+            if (hasBitboards)
+            {
+                accel._OccupiedRowBits[z] = 0;
+                for (int x = 0; x < _SizeX; x++)
+                {
+                    accel._OccupiedRowBits[z] |= std::uint64_t(line[x] != _NoPiece) << x;
+                }
+            }
+        }
+    }
+
+    for (int x = 0; x < _SizeX; x++)
+    {
+        if (touchedColumns[x])
+        {
+            PatchLine(parentAccel._OccupiedRLEMapZ, x, _SizeX, dx, dz, line, sourceLine);
+            accel._OccupiedRLEMapZ.EncodeLine(x, line.data());
+
+            // 3. contacts along z
+            AddContacts(accel._OccupiedRLEMapZ, x);
+
+            if (hasBitboards)
+            {
+                accel._OccupiedColumnBits[x] = 0;
+                for (int z = 0; z < _SizeZ; z++)
+                {
+                    accel._OccupiedColumnBits[x] |= std::uint64_t(line[z] != _NoPiece) << z;
+                }
+            }
+        }
+    }
+
+    // 4. the bitboards of a moved piece are the parent's ones shifted
+    if (hasBitboards)
+    {
+        auto Shift = [](std::uint64_t bits, int shift) {
+            return shift >= 0 ? bits << shift : bits >> -shift;
+        };
+
+        for (int pieceID : movedMask)
+        {
+            auto parentRows = parentAccel._PieceRowBits.data() + pieceID * _SizeZ;
+            auto parentColumns = parentAccel._PieceColumnBits.data() + pieceID * _SizeX;
+            auto rows = accel._PieceRowBits.data() + pieceID * _SizeZ;
+            auto columns = accel._PieceColumnBits.data() + pieceID * _SizeX;
+
+            for (int z = 0; z < _SizeZ; z++)
+            {
+                int source = z - dz;
+                rows[z] = (source >= 0 && source < _SizeZ) ? Shift(parentRows[source], dx) : 0;
+            }
+            for (int x = 0; x < _SizeX; x++)
+            {
+                int source = x - dx;
+                columns[x] = (source >= 0 && source < _SizeX) ? Shift(parentColumns[source], dz) : 0;
+            }
+        }
+
+        accel._SubasmMask = PieceMask(); // the cached subassembly bitboards belong to the parent
+    }
+}
+
+void PuzzleConfig::_BuildOccupiedBitboards(const std::vector<int> &occupiedMap)
+{
+    auto &accel = *_Accel;
+    int n = _GetTotalPieceNum();
+
+    accel._PieceRowBits.assign(n * _SizeZ, 0);
+    accel._PieceColumnBits.assign(n * _SizeX, 0);
+    accel._OccupiedRowBits.assign(_SizeZ, 0);
+    accel._OccupiedColumnBits.assign(_SizeX, 0);
+    accel._SubasmRowBits.assign(_SizeZ, 0);
+    accel._SubasmColumnBits.assign(_SizeX, 0);
+    accel._SubasmMask = PieceMask();
+
+    for (int x = 0; x < _SizeX; x++)
+    {
+        for (int z = 0; z < _SizeZ; z++)
+        {
+            int pieceID = occupiedMap[x * _SizeZ + z];
+            if (pieceID != _NoPiece)
+            {
+                accel._PieceRowBits[pieceID * _SizeZ + z] |= std::uint64_t(1) << x;
+                accel._PieceColumnBits[pieceID * _SizeX + x] |= std::uint64_t(1) << z;
+                accel._OccupiedRowBits[z] |= std::uint64_t(1) << x;
+                accel._OccupiedColumnBits[x] |= std::uint64_t(1) << z;
+            }
+        }
+    }
 }
 
 std::array<int, 4> PuzzleConfig::GetPuzzleSize() const // MinX, MinZ, SizeX, Size
@@ -550,29 +908,115 @@ std::array<int, 4> PuzzleConfig::GetPuzzleSize() const // MinX, MinZ, SizeX, Siz
     return {_MinX, _MinZ, _SizeX, _SizeZ};
 }
 
-bool PuzzleConfig::IsEqualTo(const PuzzleConfig &rhs)
+std::uint64_t PuzzleConfig::_HashPiece(int pieceID, int relX, int relZ)
+{
+    // the zobrist value of a piece at an offset relative to the anchor piece
+    // a table of random values would need an entry for every relative position, mixing the packed key gives the same for free
+    std::uint64_t x = static_cast<std::uint16_t>(relX), z = static_cast<std::uint16_t>(relZ);
+    return Mix64((static_cast<std::uint64_t>(pieceID) << 32) | (x << 16) | z);
+}
+
+void PuzzleConfig::_CalculateHash()
+{
+    // zobrist key: XOR of the values of all remaining pieces, at their offsets relative to the anchor piece (the one with the smallest ID)
+    // two configs with the same pieces are equal up to translation iff all these relative offsets are equal
+    // time complexity: O(pieceNum), _MoveSubassembly and _RemoveSubassembly update the key incrementally
+
+    std::uint64_t hash = 0;
+    if (!_PieceMask)
+    {
+        _Hash = hash;
+        return;
+    }
+
+    auto &anchor = _States[_PieceMask.GetFirstPiece()];
+    for (int pieceID : _PieceMask)
+    {
+        hash ^= _HashPiece(pieceID, _States[pieceID]._OffsetX - anchor._OffsetX, _States[pieceID]._OffsetZ - anchor._OffsetZ);
+    }
+
+    _Hash = hash;
+}
+
+void PuzzleConfig::_MoveSubassembly(PieceMask subasmMask, int dx, int dz)
+{
+    // after normalization, moving the subassembly by (dx, dz) is the same as moving the other pieces by (-dx, -dz)
+    // so only the side without the anchor piece changes its relative offsets, the key is updated from that side
+    // time complexity: O(number of pieces on that side)
+    int anchorID = _PieceMask.GetFirstPiece();
+    auto &anchor = _States[anchorID];
+
+    bool anchorMoved = subasmMask.Contains(anchorID);
+    PieceMask keyMask = anchorMoved ? (_PieceMask & ~subasmMask) : subasmMask;
+    int keyDx = anchorMoved ? -dx : dx, keyDz = anchorMoved ? -dz : dz;
+
+    for (int pieceID : keyMask)
+    {
+        int relX = _States[pieceID]._OffsetX - anchor._OffsetX, relZ = _States[pieceID]._OffsetZ - anchor._OffsetZ;
+        _Hash ^= _HashPiece(pieceID, relX, relZ) ^ _HashPiece(pieceID, relX + keyDx, relZ + keyDz);
+    }
+
+    for (int pieceID : subasmMask)
+    {
+        auto &state = _States[pieceID];
+        state._OffsetX += dx;
+        state._OffsetZ += dz;
+    }
+}
+
+void PuzzleConfig::_RemoveSubassembly(PieceMask subasmMask)
+{
+    int anchorID = _PieceMask.GetFirstPiece();
+    _PieceMask &= ~subasmMask;
+
+    // the anchor piece is removed as well: all relative offsets change
+    if (subasmMask.Contains(anchorID))
+    {
+        _CalculateHash();
+        return;
+    }
+
+    auto &anchor = _States[anchorID];
+    for (int pieceID : subasmMask)
+    {
+        _Hash ^= _HashPiece(pieceID, _States[pieceID]._OffsetX - anchor._OffsetX, _States[pieceID]._OffsetZ - anchor._OffsetZ);
+    }
+}
+
+std::size_t PuzzleConfig::GetHash() const
+{
+    return _Hash;
+}
+
+bool PuzzleConfig::IsEqualTo(const PuzzleConfig &rhs) const
 {
-    if (_Data.size() != rhs._Data.size() || _SizeX != rhs._SizeX || _SizeZ != rhs._SizeZ)
+    if (_Hash != rhs._Hash)
+    {
+        return false;
+    }
+
+    // only reached if the keys collide (or the configs are equal)
+    if (_PieceMask != rhs._PieceMask)
     {
         return false;
     }
 
-    for (auto &[pieceID, pieceInfo] : _Data)
+    if (!_PieceMask)
     {
-        auto iter = rhs._Data.find(pieceID);
-        if (iter == _Data.end())
+        return true;
+    }
+
+    // the same normalization as the key: offsets relative to the anchor piece
+    int anchorID = _PieceMask.GetFirstPiece();
+    auto &anchor = _States[anchorID], &rhsAnchor = rhs._States[anchorID];
+    for (int pieceID : _PieceMask)
+    {
+        int relX = _States[pieceID]._OffsetX - anchor._OffsetX, relZ = _States[pieceID]._OffsetZ - anchor._OffsetZ;
+        int rhsRelX = rhs._States[pieceID]._OffsetX - rhsAnchor._OffsetX, rhsRelZ = rhs._States[pieceID]._OffsetZ - rhsAnchor._OffsetZ;
+        if (relX != rhsRelX || relZ != rhsRelZ)
         {
             return false;
         }
-        else
-        {
-            int relX = pieceInfo._State._OffsetX - _MinX, relZ = pieceInfo._State._OffsetZ - _MinZ;
-            int rhsRelX = iter->second._State._OffsetX - rhs._MinX, rhsRelZ = iter->second._State._OffsetZ - rhs._MinZ;
-            if (relX != rhsRelX || relZ != rhsRelZ)
-            {
-                return false;
-            }
-        }
     }
 
     return true;
@@ -580,10 +1024,50 @@ bool PuzzleConfig::IsEqualTo(const PuzzleConfig &rhs)
 
 int PuzzleConfig::GetPuzzlePieceNum() const
 {
-    return _PieceIDs.size();
+    return _PieceMask.GetPieceNum();
 }
 
 int PuzzleConfig::GetRemovedPieceNum() const
 {
-    return _OriginalPieceNum - _PieceIDs.size();
+    return _GetTotalPieceNum() - GetPuzzlePieceNum();
+}
+
+PieceMask PuzzleConfig::GetPieceMask() const
+{
+    return _PieceMask;
+}
+
+const PuzzleMove &PuzzleConfig::GetLastMove() const
+{
+    return _LastMove;
+}
+
+const PuzzlePieceState &PuzzleConfig::GetPieceState(int pieceID) const
+{
+    return _States[pieceID];
+}
+
+std::size_t PuzzleConfig::GetMemoryUsage() const
+{
+    std::size_t usage = sizeof(PuzzleConfig) + _GetTotalPieceNum() * sizeof(PuzzlePieceState); // the states in the arena
+    if (_Accel)
+    {
+        usage += _Accel->GetMemoryUsage();
+    }
+
+    return usage;
+}
+
+std::size_t PuzzleConfig::AccelStructures::GetMemoryUsage() const
+{
+    std::size_t usage = sizeof(AccelStructures);
+    usage += _AdjacencyGraph.capacity() * sizeof(PieceMask);
+
+    usage += _OccupiedRLEMapX.GetMemoryUsage() + _OccupiedRLEMapZ.GetMemoryUsage();
+
+    usage += (_PieceRowBits.capacity() + _PieceColumnBits.capacity() + _OccupiedRowBits.capacity() + _OccupiedColumnBits.capacity() +
+              _SubasmRowBits.capacity() + _SubasmColumnBits.capacity()) *
+             sizeof(std::uint64_t);
+
+    return usage;
 }
@@ -1,40 +1,56 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <functional>
 #include <memory>
-#include <set>
-#include <unordered_set>
 #include <vector>
 
-#include "Shader.h"
-#include "VertexBuffer.h"
-
 #include "PuzzlePiece.h"
-#include "Shader.h"
 #include "Utils.h"
-#include "VertexBuffer.h"
+
+// how _CalculateMaxMovableDistance finds the blocking voxels
+enum class CollisionBackend
+{
+    RLE,     // binary search + walk in the occupied RLE maps, works for puzzles of any size
+    BITBOARD // shifts & bit scans on per-row / per-column occupancy words, puzzles up to 64 x 64 (larger ones fall back to RLE)
+};
 
 class PuzzleConfig
 {
 public:
-    explicit PuzzleConfig(int depth, int originalPieceNum);
+    PuzzleConfig() = default;
+    // all pieces of the geometry are placed without offsets, the geometry and the arena must outlive the config
+    PuzzleConfig(const PuzzleGeometry *geometry, int depth, Arena<PuzzlePieceState> &stateArena);
 
-    // construct the config, these function should be called first before other operations
-    void AddPuzzlePiece(int pieceID, const PuzzlePieceInfo &puzzlePieceInfo);
-    void AddPuzzlePiece(int pieceID, std::shared_ptr<PuzzlePiece> puzzlePiece);
-    void AddPuzzlePiece(int pieceID, std::shared_ptr<PuzzlePiece> puzzlePiece, const PuzzlePieceState &state);
+    // the backend is read when the acceleration structures are built, select it before solving
+    static void SetCollisionBackend(CollisionBackend backend);
+    static CollisionBackend GetCollisionBackend();
 
-    // --> ONLY used when enumerating neighbor configs, to keep materials unchanged
-    void SetPieceMaterial(int pieceID, const PuzzlePieceMaterial &material);
-
-    // these functions are supposed to be called ONLY ONCE for one object
-    void AssignPuzzlePieceMaterials();
+    // acceleration structures are NOT stored in every config, build them on demand and release them when they are no longer needed
+    // CalculateNeighborConfigs will build them temporarily if they are missing
     void BuildAccelStructures();
-    void CalculateNeighborConfigs(std::vector<std::shared_ptr<PuzzleConfig>> &neighborConfigs);
-
-    // rendering
-    void Render(Shader &shader, VertexBuffer &voxelModel);
+    void ReleaseAccelStructures();
+    bool HasAccelStructures() const;
+    // for a neighbor reached by moving a subassembly: patch the parent's structures instead of building them from scratch
+    // the parent must have its acceleration structures, otherwise (or if this is not such a neighbor) they are built as usual
+    void DeriveAccelStructures(const PuzzleConfig &parent);
+
+    // the states of the neighbors are allocated from stateArena
+    void CalculateNeighborConfigs(std::vector<PuzzleConfig> &neighborConfigs, Arena<PuzzlePieceState> &stateArena);
+    // lazy version: callback(neighborConfig) gets one neighbor at a time (it may move from it), return false to stop
+    // all removals are generated before any move, so a search for a target config stops without paying for the moves
+    void GenerateNeighborConfigs(Arena<PuzzlePieceState> &stateArena, const std::function<bool(PuzzleConfig &)> &callback);
+    // copies the states into another arena, e.g. when a neighbor becomes a graph node and its old arena is cleared
+    void RelocateStates(Arena<PuzzlePieceState> &stateArena);
+    // the config reached by the move (one level deeper), its states are allocated from stateArena
+    PuzzleConfig MakeNeighborConfig(const PuzzleMove &move, Arena<PuzzlePieceState> &stateArena) const;
+    // the same in place, e.g. to replay a chain of moves without copying (the acceleration structures are released)
+    void ApplyMove(const PuzzleMove &move);
+
+    // rendering (no rendering code here, the solver must stay headless)
+    // callback(pieceID, x, z, length): the voxels (x, z), (x, z + 1), ..., (x, z + length - 1) belong to pieceID
+    void TraverseOccupiedRuns(const std::function<void(int, int, int, int)> &callback);
 
     // queries
     int GetDepth() const;
@@ -42,28 +58,47 @@ public:
     std::array<int, 4> GetPuzzleSize() const; // MinX, MinZ, SizeX, SizeZ
     int GetPuzzlePieceNum() const;
     int GetRemovedPieceNum() const;
-    bool IsEqualTo(const PuzzleConfig &rhs);
+    PieceMask GetPieceMask() const;
+    const PuzzleMove &GetLastMove() const; // the move from the parent config
+    const PuzzlePieceState &GetPieceState(int pieceID) const;
+    bool IsEqualTo(const PuzzleConfig &rhs) const;
+    std::size_t GetHash() const;        // zobrist key, translation-normalized: equal configs always have equal keys
+    std::size_t GetMemoryUsage() const; // in bytes, including the acceleration structures (if any)
 
 public:
     // helpers, don't use them directly unless for test
-    void _EnumerateSubassembly(int depth, std::set<int> &pieceIDs, const std::function<void()> &callback);
-    bool _ValidateSubassembly(std::set<int> &pieceIDs); // through DFS
-    void _BuildSubassemblyValidater();                  // through DSU
+    // callback(subasmMask) is invoked exactly once for every connected subassembly with at most half of the remaining pieces
+    // unless it returns false, which stops the enumeration (and makes it return false)
+    bool _EnumerateSubassembly(const std::function<bool(PieceMask)> &callback);
+    bool _EnumerateSubassembly(PieceMask subasmMask, PieceMask extensionMask, PieceMask excludedMask, int maxPieceNum,
+                               const std::function<bool(PieceMask)> &callback);
+    PuzzleConfig Clone(Arena<PuzzlePieceState> &stateArena) const; // same state, without acceleration structures
+    int _GetTotalPieceNum() const;                                         // including the removed pieces
     void _CalculateBoundingBox();
-    void _BuildAdjacencyGraph(std::vector<std::vector<int>> &occupiedMap);
-    void _BuildOccupiedRLEMap(std::vector<std::vector<int>> &occupiedMap);
-    int _CalculateMaxMovableDistance(std::set<int> &pieceIDs, int diretction);
+    void _CalculateHash();
+    void _MoveSubassembly(PieceMask subasmMask, int dx, int dz); // moves the pieces and updates the key incrementally
+    void _RemoveSubassembly(PieceMask subasmMask);               // ditto
+    static std::uint64_t _HashPiece(int pieceID, int relX, int relZ);
+    // occupiedMap[x * _SizeZ + z]: the piece at the mapped coordinate (x, z), or _NoPiece
+    void _BuildAdjacencyGraph(const std::vector<int> &occupiedMap);
+    void _BuildOccupiedRLEMap(const std::vector<int> &occupiedMap);
+    void _BuildOccupiedBitboards(const std::vector<int> &occupiedMap);
+    int _CalculateMaxMovableDistance(PieceMask subasmMask, int direction); // dispatches to one of the backends below
+    int _CalculateMaxMovableDistanceRLE(PieceMask subasmMask, int direction);
+    int _CalculateMaxMovableDistanceBitboard(PieceMask subasmMask, int direction);
 
 private:
-    std::unordered_map<int, PuzzlePieceInfo> _Data;
-    std::vector<int> _PieceIDs; // mainly used for enumerating subassemblies
+    // compact state: the geometry is shared, only the offsets are stored per config
+    const PuzzleGeometry *_Geometry = nullptr;
+    PuzzlePieceState *_States = nullptr; // indexed by piece ID, owned by an arena, states of removed pieces are meaningless
+    PieceMask _PieceMask;                // pieces which are not removed yet
+    PuzzleMove _LastMove;
 
     // values for query
     int _Depth = 0;
-    int _OriginalPieceNum = 0;
-
-    // rendering: it's meaningless to generate something invisible!
-    std::unordered_map<int, PuzzlePieceMaterial> _PuzzlePieceMaterialsMap;
+    int _MinX = 0, _MinZ = 0;
+    int _SizeX = 0, _SizeZ = 0;
+    std::size_t _Hash = 0;
 
     // accelration structures
     struct RLEInfo
@@ -71,18 +106,53 @@ private:
         int _PieceID;
         int _Length;
     };
-    std::unordered_map<int, std::unordered_set<int>> _AdjacencyGraph;
-    std::vector<std::vector<RLEInfo>> _OccupiedRLEMapX;
-    std::vector<std::vector<RLEInfo>> _OccupiedRLEMapZ;
-    std::vector<std::vector<int>> _OccupiedRLEMapPreX;
-    std::vector<std::vector<int>> _OccupiedRLEMapPreZ;
-    DSU _SubasmValidator;
-    int _MinX, _MaxX, _MinZ, _MaxZ;
-    int _SizeX, _SizeZ;
+
+    // runs of all lines (rows or columns) of the bounding box in one block, so that copying a map is cheap
+    // every line has room for the max number of runs, i.e. its length
+    struct RLEMap
+    {
+        void Init(int lineNum, int lineLength);
+        int GetRunNum(int line) const;
+        RLEInfo *GetRuns(int line);
+        const RLEInfo *GetRuns(int line) const;
+        int *GetRunsPre(int line); // GetRunsPre(line)[i]: where run i starts, GetRunsPre(line)[GetRunNum(line)] == _LineLength
+        const int *GetRunsPre(int line) const;
+        void EncodeLine(int line, const int *cells);
+        void DecodeLine(int line, int *cells) const;
+        std::size_t GetMemoryUsage() const;
+
+        int _LineLength = 0;
+        std::vector<RLEInfo> _Runs;
+        std::vector<int> _RunsPre;
+        std::vector<int> _RunNums;
+    };
+
+    struct AccelStructures
+    {
+        std::size_t GetMemoryUsage() const;
+
+        std::vector<PieceMask> _AdjacencyGraph; // indexed by piece ID
+        RLEMap _OccupiedRLEMapX; // line z: runs along x
+        RLEMap _OccupiedRLEMapZ; // line x: runs along z
+
+        // bitboards, empty unless the bitboard backend is used
+        // row z holds the voxels (0..63, z) as bits, column x holds the voxels (x, 0..63)
+        std::vector<std::uint64_t> _PieceRowBits;    // [pieceID * _SizeZ + z]
+        std::vector<std::uint64_t> _PieceColumnBits; // [pieceID * _SizeX + x]
+        std::vector<std::uint64_t> _OccupiedRowBits;
+        std::vector<std::uint64_t> _OccupiedColumnBits;
+
+        // the same subassembly is tested in all four directions, so its bitboards are kept until another one comes
+        PieceMask _SubasmMask;
+        std::vector<std::uint64_t> _SubasmRowBits;
+        std::vector<std::uint64_t> _SubasmColumnBits;
+    };
+    std::unique_ptr<AccelStructures> _Accel;
 
     // constants
     static int _NoPiece;
     static int _Inf;
+    static CollisionBackend _CollisionBackend;
 
     static int _DxArray[4];
     static int _DzArray[4];
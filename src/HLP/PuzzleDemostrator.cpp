@@ -1,92 +1,106 @@
 #include "PuzzleDemostrator.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cstdio>
 
 #include <imgui.h>
 
 #include "Logger.h"
+#include "Profiler.h"
 #include "Timer.h"
 #include "UI.h"
 #include "Utils.h"
 
 #include "HLP_Config.h"
+#include "PuzzleFile.h"
+
+PuzzleDemonstrator::~PuzzleDemonstrator()
+{
+    if (_SolverThread.joinable())
+    {
+        _DasmGraph.CancelBuild();
+        _SolverThread.join();
+    }
+
+    if (_GeneratorThread.joinable())
+    {
+        _Generator.Cancel();
+        _GeneratorThread.join();
+    }
+}
 
 void PuzzleDemonstrator::Init()
 {
-    InitVoxelModel();
     InitShaders();
+    _PuzzleRenderer.Init();
 
+    // with the index this is nearly free unless some files changed
+    _PuzzleFileIndex.Init(cPuzzleFileFolder);
+    _PuzzleFiles = _PuzzleFileIndex.GetPuzzleFiles();
+    _SolutionCache.Init(cSolutionCacheFolder);
     gTimer.DispatchLoopTask(1.0f, [&]() { DetectPuzzleFiles(); });
 }
 
 void PuzzleDemonstrator::CorrectCameraPos()
 {
-    auto &config = _DasmGraph.GetPuzzleConfig(_CurrentConfigID);
-    auto [minX, minZ, sizeX, sizeZ] = config.GetPuzzleSize();
+    auto [minX, minZ, sizeX, sizeZ] = _DisplayedConfig.GetPuzzleSize();
     _Camera.SetCameraPos({minX + sizeX / 2.0, 15.0f, minZ + sizeZ / 2.0 + 0.01f});
     _Camera.LookAt({minX + sizeX / 2.0, 0.0f, minZ + sizeZ / 2.0});
 }
 
-void PuzzleDemonstrator::InitVoxelModel()
-{
-    float vertices[] = {-0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.5f,  -0.5f, -0.5f, 1.0f, 0.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f,
-                        0.5f,  0.5f,  -0.5f, 1.0f, 1.0f, -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f, -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
-
-                        -0.5f, -0.5f, 0.5f,  0.0f, 0.0f, 0.5f,  -0.5f, 0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-                        0.5f,  0.5f,  0.5f,  1.0f, 1.0f, -0.5f, 0.5f,  0.5f,  0.0f, 1.0f, -0.5f, -0.5f, 0.5f,  0.0f, 0.0f,
-
-                        -0.5f, 0.5f,  0.5f,  1.0f, 0.0f, -0.5f, 0.5f,  -0.5f, 1.0f, 1.0f, -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
-                        -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, -0.5f, -0.5f, 0.5f,  0.0f, 0.0f, -0.5f, 0.5f,  0.5f,  1.0f, 0.0f,
-
-                        0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f, 0.5f,  -0.5f, -0.5f, 0.0f, 1.0f,
-                        0.5f,  -0.5f, -0.5f, 0.0f, 1.0f, 0.5f,  -0.5f, 0.5f,  0.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-                        -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, 0.5f,  -0.5f, -0.5f, 1.0f, 1.0f, 0.5f,  -0.5f, 0.5f,  1.0f, 0.0f,
-                        0.5f,  -0.5f, 0.5f,  1.0f, 0.0f, -0.5f, -0.5f, 0.5f,  0.0f, 0.0f, -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
-
-                        -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-                        0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -0.5f, 0.5f,  0.5f,  0.0f, 0.0f, -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f};
-
-    _VoxelModel.SetData(vertices, sizeof(vertices) / sizeof(float)).SetUsage(0, 3).SetUsage(1, 2).EndSetUsage();
-}
-
 void PuzzleDemonstrator::InitShaders()
 {
     ShaderInfo shaderInfo;
     shaderInfo._VertexShaderPath = cpBasicShaderVSPath;
     shaderInfo._FragmentShaderPath = cpBasicShaderFSPath;
     _BasicShader.Init(shaderInfo);
+    _WireframeUniform = _BasicShader.GetUniformHandle<int>("wireframe");
+
+    _CameraUniforms.Init(cCameraUniformBinding, sizeof(CameraUniforms));
+    UpdateCameraUniforms();
+}
 
-    _BasicShader.Activate();
-    _BasicShader.SetUniform("view", _Camera.GetViewMatrix());
-    _BasicShader.SetUniform("proj", _Camera.GetProjectionMatrix());
+void PuzzleDemonstrator::UpdateCameraUniforms()
+{
+    CameraUniforms cameraUniforms = {_Camera.GetViewMatrix(), _Camera.GetProjectionMatrix()};
+    _CameraUniforms.Update(&cameraUniforms, sizeof(cameraUniforms));
 }
 
 void PuzzleDemonstrator::Tick(float dt)
 {
+    PROFILE_SCOPE("Demo: tick");
+
     _DeltaTime = dt;
     _Camera.Update(dt);
 
-    _BasicShader.Activate();
-    _BasicShader.SetUniform("view", _Camera.GetViewMatrix());
+    UpdateSolvingState();
+    UpdateGeneratingState();
+    UpdateDisplayedConfig();
 
-    if (_PuzzleImported && _PrevConfigID != _CurrentConfigID)
+    if (_PuzzleImported && _PrevConfigID != _DisplayedConfigID)
     {
-        _PrevConfigID = _CurrentConfigID;
+        _PrevConfigID = _DisplayedConfigID;
         CorrectCameraPos();
     }
+
+    // once per frame for all shaders, after the camera has settled
+    UpdateCameraUniforms();
 }
 
 void PuzzleDemonstrator::RenderPuzzle()
 {
     if (_PuzzleImported)
     {
-        _DasmGraph.RenderConfig(_CurrentConfigID, _BasicShader, _VoxelModel);
+        _BasicShader.Activate();
+        _BasicShader.SetUniform(_WireframeUniform, _Wireframe ? 1 : 0);
+        _PuzzleRenderer.Render(_BasicShader);
     }
 }
 
 void PuzzleDemonstrator::RenderMenu()
 {
+    PROFILE_SCOPE("Demo: menu");
+
 #ifdef MY_DEBUG
     ui::internal::ShowDemoWindow();
 #endif
@@ -94,14 +108,19 @@ void PuzzleDemonstrator::RenderMenu()
     ui::StandardWindow("HLP Demo Menu", [&]() {
         RenderMenu_FPSPanel();
 
+        if (ImGui::CollapsingHeader("PROFILER"))
+        {
+            RenderMenu_Profiler();
+        }
+
         if (ImGui::CollapsingHeader("DISASSEMBLY PLANNER"))
         {
             RenderMenu_DasmPlanner();
         }
 
-        if (ImGui::CollapsingHeader("PUZZLE GENERATOR (WIP)"))
+        if (ImGui::CollapsingHeader("PUZZLE GENERATOR"))
         {
-            ;
+            RenderMenu_Generator();
         }
 
         ImGui::End();
@@ -111,80 +130,133 @@ void PuzzleDemonstrator::RenderMenu()
 void PuzzleDemonstrator::RenderMenu_FPSPanel()
 {
     static float fpsArr[64];
-    static int fpsArrWriteIdx = 0;
+    static int fpsArrWriteIdx = 0; // also the oldest value, where the plot starts
 
-    int currentFPS = std::floor(1.0f / _DeltaTime);
+    int currentFPS = _DeltaTime > 0.0f ? std::floor(1.0f / _DeltaTime) : 0;
 
     fpsArr[fpsArrWriteIdx] = currentFPS;
+    fpsArrWriteIdx = (fpsArrWriteIdx + 1) % IM_ARRAYSIZE(fpsArr);
 
-    if (fpsArrWriteIdx == 64)
-        fpsArrWriteIdx = 0;
-    else
-        ++fpsArrWriteIdx;
-
-    ImGui::PlotLines("", fpsArr, IM_ARRAYSIZE(fpsArr));
+    ImGui::PlotLines("", fpsArr, IM_ARRAYSIZE(fpsArr), fpsArrWriteIdx);
     ImGui::SameLine();
     ImGui::Text("FPS: %d", currentFPS);
 }
 
-void PuzzleDemonstrator::RenderMenu_DasmPlanner()
+void PuzzleDemonstrator::RenderMenu_Profiler()
 {
-    static int selected = 0;
+    if (ImGui::Button("RESET"))
+    {
+        gProfiler.Reset();
+    }
+    ImGui::SameLine();
+    ui::HelpMarker("CPU and GPU time of the scopes in ms, over their last runs. "
+                   "The frame scopes run once per frame, the solver scopes once per build / level (on the solver threads). "
+                   "The bars are the last runs, oldest first.");
 
+    auto statsVec = gProfiler.GetStats();
+    if (statsVec.empty())
+    {
+        ImGui::TextDisabled("(nothing recorded yet)");
+        return;
+    }
+
+    if (ImGui::BeginTable("profiler", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+    {
+        ImGui::TableSetupColumn("scope");
+        ImGui::TableSetupColumn("mean");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("max");
+        ImGui::TableSetupColumn("last runs");
+        ImGui::TableHeadersRow();
+
+        for (auto &stats : statsVec)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stats._Name.c_str());
+            for (float value : {stats._Mean, stats._P50, stats._P95, stats._P99, stats._Max})
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", value);
+            }
+
+            ImGui::TableNextColumn();
+            ImGui::PushID(stats._Name.c_str());
+            ImGui::PlotHistogram("", stats._Samples.data(), stats._Samples.size(), 0, nullptr, 0.0f, stats._Max,
+                                 ImVec2(-1.0f, ImGui::GetFontSize()));
+            ImGui::PopID();
+        }
+
+        ImGui::EndTable();
+    }
+}
+
+void PuzzleDemonstrator::RenderMenu_DasmPlanner()
+{
     // display puzzle file selction menu
     if (_PuzzleFiles.empty())
     {
-        ui::Combo(selected, _PuzzleFiles, "(no puzzle files found )");
+        ui::Combo(_SelectedPuzzleFile, _PuzzleFiles, "(no puzzle files found )");
     }
     else
     {
-        ui::Combo(selected, _PuzzleFiles, _PuzzleFiles[selected]);
+        ui::Combo(_SelectedPuzzleFile, _PuzzleFiles, _PuzzleFiles[_SelectedPuzzleFile]);
     }
 
     ImGui::SameLine();
 
-    if (ImGui::Button("IMPORT") && !_PuzzleFiles.empty())
+    if (ImGui::Button("IMPORT") && !_PuzzleFiles.empty() && !_Solving)
     {
-        std::string puzzleFilePath = (fs::path(cPuzzleFileFolder) / _PuzzleFiles[selected]).string();
-        if (_DasmGraph.ImportPuzzle(puzzleFilePath)) // in case the import fails
-        {
-            _PuzzleImported = true;
-            _CurrentConfigID = 0;
-            _CurrentPlanOffset = 0;
-            _PrevConfigID = -1;
-        }
+        ImportPuzzle((fs::path(cPuzzleFileFolder) / _PuzzleFiles[_SelectedPuzzleFile]).string());
     }
     ImGui::SameLine();
     ui::HelpMarker("Put puzzle files in \"resources\" folder");
+    if (!_DasmGraph.GetImportError().empty())
+    {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Import failed: %s", _DasmGraph.GetImportError().c_str());
+    }
 
     if (_PuzzleImported)
     {
-        std::string currentPuzzlePath = _PuzzleFiles[selected];
-        currentPuzzlePath = currentPuzzlePath.substr(0, currentPuzzlePath.find('.')); // strip the extension
-        ImGui::Text("Loaded Puzzle: <%s>", currentPuzzlePath.c_str());
+        // the file list may have changed since, so the name comes from the imported path
+        ImGui::Text("Loaded Puzzle: <%s>", fs::path(_PuzzleFilePath).stem().string().c_str());
 
-        auto &currentConfig = _DasmGraph.GetPuzzleConfig(_CurrentConfigID);
-        auto configSize = currentConfig.GetPuzzleSize();
-        auto depth = currentConfig.GetDepth();
+        // the displayed config is a copy, it may lag behind _CurrentConfigID for a few frames while the solver holds the graph
+        auto configSize = _DisplayedConfig.GetPuzzleSize();
+        auto depth = _DisplayedConfig.GetDepth();
+        // the graph grows while solving, but it's browsable up to the last merged level
+        int configNum = std::max(1, _DasmGraph.GetBuildProgress()._NodeNum);
 
         ImGui::SeparatorText("Current Config Info");
         {
-            ImGui::Text("ID: #%d", _CurrentConfigID);
+            static int equalityCheckIDs[2] = {0, 0};
+            static bool equalityCheckRes = true;
+            if (auto graphLock = _DasmGraph.TryLockGraph())
+            {
+                _GraphMemoryUsage = _DasmGraph.GetMemoryUsage();
+                _GraphMemoryUsagePerNode = _DasmGraph.GetMemoryUsagePerNode();
+
+                // test: check if two config is equal
+                equalityCheckIDs[0] = std::clamp(equalityCheckIDs[0], 0, configNum - 1);
+                equalityCheckIDs[1] = std::clamp(equalityCheckIDs[1], 0, configNum - 1);
+                auto &lhs = _DasmGraph.GetPuzzleConfig(equalityCheckIDs[0]);
+                equalityCheckRes = lhs.IsEqualTo(_DasmGraph.GetPuzzleConfig(equalityCheckIDs[1]));
+            }
+
+            ImGui::Text("ID: #%d", _DisplayedConfigID);
             ImGui::Text("MinX = %d, MinZ = %d, SizeX = %d, SizeZ = %d", configSize[0], configSize[1], configSize[2], configSize[3]);
             ImGui::Text("Depth: %d", depth);
+            ImGui::Text("Graph Memory: %.2f MB (%.1f B / node)", _GraphMemoryUsage / 1048576.0, _GraphMemoryUsagePerNode);
 
-            bool isFullConfig = currentConfig.IsFullConfig();
+            bool isFullConfig = _DisplayedConfig.IsFullConfig();
             ImGui::Checkbox("Full Config", &isFullConfig);
 
-            // test: check if two config is equal
-            static int equalityCheckIDs[2] = {0, 0};
-            bool equalityCheckRes =
-                (_DasmGraph.GetPuzzleConfig(equalityCheckIDs[0]).IsEqualTo(_DasmGraph.GetPuzzleConfig(equalityCheckIDs[1])));
             ImGui::Checkbox("Check Equality", &equalityCheckRes);
             ImGui::SameLine();
             ImGui::InputInt2("", equalityCheckIDs);
 
-            int configNum = _DasmGraph.GetPuzzleConfigNum();
             if (ImGui::Button("Prev Config"))
             {
                 _CurrentConfigID = (_CurrentConfigID - 1 + configNum) % configNum;
@@ -197,22 +269,47 @@ void PuzzleDemonstrator::RenderMenu_DasmPlanner()
             }
         }
 
+        ImGui::SeparatorText("Rendering");
+        {
+            if (ImGui::Checkbox("Greedy Meshes", &_GreedyMeshing))
+            {
+                _PuzzleRenderer.SetGreedyMeshing(_GreedyMeshing);
+                if (_DisplayedConfigID != -1)
+                {
+                    _PuzzleRenderer.SetConfig(_DisplayedConfigID, _DisplayedConfig);
+                }
+            }
+            ImGui::SameLine();
+            ui::HelpMarker("Unchecked: every voxel is an instance of a unit cube, drawn with one instanced draw call");
+            ImGui::Checkbox("Wireframe", &_Wireframe);
+        }
+
         ImGui::SeparatorText("Disassemble Puzzle");
         {
-            if (!_DasmGraph.IsDisasmGraphBuilt())
+            if (_Solving)
+            {
+                auto progress = _DasmGraph.GetBuildProgress();
+                ImGui::Text("Solving... %.1f s", _SolveTime);
+                ImGui::Text("Expanded: %d, Frontier: %d, Depth: %d", progress._ExpandedNum, progress._FrontierSize, progress._Depth);
+
+                if (ImGui::Button("Cancel"))
+                {
+                    _DasmGraph.CancelBuild();
+                }
+            }
+            else if (!_DasmGraph.IsDisasmGraphBuilt())
             {
                 if (ImGui::Button("Disassemble [Kernel]"))
                 {
-                    _DasmGraph.BuildKernelDisassemblyGraph();
+                    StartSolving(false);
                 }
 
                 if (ImGui::Button("Disassemble [Complete]"))
                 {
-                    _DasmGraph.BuildCompleteDisassemblyGraph();
+                    StartSolving(true);
                 }
             }
-
-            if (_DasmGraph.IsDisasmGraphBuilt())
+            else
             {
                 int disasmPlanSize = _DasmGraph.GetDisasmPlanSize();
                 if (ImGui::Button("Prev Disasm Config"))
@@ -229,23 +326,189 @@ void PuzzleDemonstrator::RenderMenu_DasmPlanner()
                 }
 
                 ImGui::Text("Difficulty: %d", _DasmGraph.GetPuzzleDifficulty());
+                if (_SolutionCached)
+                {
+                    ImGui::Text("Loaded from the solution cache");
+                }
+                else
+                {
+                    ImGui::Text("Solved in %.2f s", _SolveTime);
+                }
             }
         }
     }
 }
 
+void PuzzleDemonstrator::RenderMenu_Generator()
+{
+    if (_Generating)
+    {
+        if (ImGui::Button("Cancel"))
+        {
+            _Generator.Cancel();
+        }
+    }
+    else
+    {
+        ImGui::InputInt2("Board Size", _GeneratorBoardSize);
+        ImGui::InputInt("Frame Opening", &_GeneratorOpeningWidth);
+        ImGui::InputInt("Pieces", &_GeneratorSettings._PieceNum);
+        ImGui::InputInt("Empty Cells", &_GeneratorSettings._EmptyCellNum);
+        ImGui::InputInt("Difficulty", &_GeneratorSettings._TargetDifficulty);
+        ImGui::InputInt("Puzzles", &_GeneratorSettings._PuzzleNum);
+        ImGui::InputInt("Search Budget", &_GeneratorSettings._MaxExpandedNum);
+
+        if (ImGui::Button("GENERATE"))
+        {
+            StartGenerating();
+        }
+    }
+    ImGui::SameLine();
+    ui::HelpMarker("The board is a frame (one piece) around the free cells, which are split into the other pieces. "
+                   "Difficulty: the moves before the first removal. "
+                   "Search budget: the configs a candidate may expand before it's rejected. "
+                   "The puzzles are saved to the \"resources\" folder.");
+
+    if (!_Generating && _GeneratorFailed) // written before _Generating is cleared
+    {
+        ImGui::Text("Invalid settings: the pieces and the empty cells must fit the board");
+    }
+
+    auto stats = _Generator.GetStats();
+    if (stats._CandidateNum > 0)
+    {
+        ImGui::Text("Generated: %lld puzzle(s) in %.1f s", (long long)stats._AcceptedNum, stats._Time);
+        ImGui::Text("Candidates: %lld (%.0f / s)", (long long)stats._CandidateNum, stats.GetCandidatesPerSecond());
+        ImGui::Text("Too easy: %lld, over budget: %lld", (long long)stats._TooEasyNum, (long long)stats._OverBudgetNum);
+        ImGui::Text("Unsolvable: %lld, duplicate: %lld", (long long)stats._UnsolvableNum, (long long)stats._DuplicateNum);
+    }
+}
+
 void PuzzleDemonstrator::DetectPuzzleFiles()
 {
-    _PuzzleFiles.clear();
+    if (!_PuzzleFileIndex.Refresh())
+    {
+        return;
+    }
+
+    // keep the selected file selected, wherever it moved in the list
+    std::string selectedPuzzleFile = _PuzzleFiles.empty() ? "" : _PuzzleFiles[_SelectedPuzzleFile];
+    _PuzzleFiles = _PuzzleFileIndex.GetPuzzleFiles();
+
+    auto iter = std::find(_PuzzleFiles.begin(), _PuzzleFiles.end(), selectedPuzzleFile);
+    _SelectedPuzzleFile = (iter != _PuzzleFiles.end()) ? iter - _PuzzleFiles.begin() : 0;
+}
+
+bool PuzzleDemonstrator::ImportPuzzle(const std::string &puzzleFilePath)
+{
+    if (!_DasmGraph.ImportPuzzle(puzzleFilePath)) // in case the import fails
+    {
+        return false;
+    }
+
+    // a puzzle solved before is shown solved right away, the complete plan is preferred
+    _SolutionCached = _SolutionCache.Load(_DasmGraph, true) || _SolutionCache.Load(_DasmGraph, false);
+
+    // assign the materials to the pieces
+    // in order to distinguish them
+    _PuzzleRenderer.AssignPuzzlePieceMaterials(_DasmGraph.GetPuzzleConfig(0).GetPuzzlePieceNum());
+
+    _PuzzleFilePath = puzzleFilePath;
+    _PuzzleImported = true;
+    _CurrentConfigID = 0;
+    _CurrentPlanOffset = 0;
+    _PrevConfigID = -1;
+    _DisplayedConfigID = -1;
+    UpdateDisplayedConfig(); // nobody else holds the graph now
+
+    return true;
+}
+
+void PuzzleDemonstrator::StartSolving(bool complete)
+{
+    // a cancelled solve leaves its partial graph behind, start over
+    if (_DasmGraph.GetPuzzleConfigNum() > 1 && !ImportPuzzle(_PuzzleFilePath))
+    {
+        return;
+    }
 
-    TraverseFolder(cPuzzleFileFolder, [&](const fs::path &filePath) {
-        std::ifstream fin(filePath);
-        int magicNumber = 0;
-        fin >> magicNumber;
-        fin.close();
-        if (magicNumber == cPuzzleFileMagicNumber)
+    _Solving = true;
+    _SolveStartTime = std::chrono::steady_clock::now();
+    _SolveTime = 0.0f;
+
+    // the search itself is spread over the thread pool, this thread only drives it level by level
+    _SolverThread = std::thread([this, complete]() {
+        if (complete)
+        {
+            _DasmGraph.BuildCompleteDisassemblyGraph();
+        }
+        else
         {
-            _PuzzleFiles.push_back(filePath.filename().string());
+            _DasmGraph.BuildKernelDisassemblyGraph();
         }
+        _SolutionCache.Store(_DasmGraph, complete); // unless cancelled / not disassemblable
+
+        _Solving = false;
     });
 }
+
+void PuzzleDemonstrator::UpdateSolvingState()
+{
+    if (!_SolverThread.joinable())
+    {
+        return;
+    }
+
+    namespace ch = std::chrono;
+    _SolveTime = ch::duration<float>(ch::steady_clock::now() - _SolveStartTime).count();
+
+    if (!_Solving) // finished (or cancelled)
+    {
+        _SolverThread.join();
+    }
+}
+
+void PuzzleDemonstrator::StartGenerating()
+{
+    _GeneratorSettings._Board = BoardShape::MakeRectangle(_GeneratorBoardSize[0], _GeneratorBoardSize[1], _GeneratorOpeningWidth);
+    _GeneratorSettings._Seed = std::chrono::steady_clock::now().time_since_epoch().count(); // other puzzles every time
+    _GeneratorFailed = false;
+    _Generating = true;
+
+    // the candidates are solved on the thread pool, this thread only waits for the workers
+    // the puzzle file index picks the new files up
+    _GeneratorThread = std::thread([this, settings = _GeneratorSettings]() {
+        _GeneratorFailed = !_Generator.Generate(settings, [&](std::vector<PuzzlePiece> &&pieces, std::uint64_t hash) {
+            char fileName[64];
+            std::snprintf(fileName, sizeof(fileName), "gen_d%d_%016llx.cfg", settings._TargetDifficulty, (unsigned long long)hash);
+            WriteTextPuzzleFile((fs::path(cPuzzleFileFolder) / fileName).string(), pieces);
+        });
+
+        _Generating = false;
+    });
+}
+
+void PuzzleDemonstrator::UpdateGeneratingState()
+{
+    if (_GeneratorThread.joinable() && !_Generating) // finished (or cancelled)
+    {
+        _GeneratorThread.join();
+    }
+}
+
+void PuzzleDemonstrator::UpdateDisplayedConfig()
+{
+    if (!_PuzzleImported || _DisplayedConfigID == _CurrentConfigID)
+    {
+        return;
+    }
+
+    // if the solver holds the graph, try again in the next frame
+    if (auto graphLock = _DasmGraph.TryLockGraph())
+    {
+        _DisplayedStateArena.Clear();
+        _DisplayedConfig = _DasmGraph.GetPuzzleConfig(_CurrentConfigID).Clone(_DisplayedStateArena);
+        _DisplayedConfigID = _CurrentConfigID;
+        _PuzzleRenderer.SetConfig(_DisplayedConfigID, _DisplayedConfig); // meshed only the first time
+    }
+}
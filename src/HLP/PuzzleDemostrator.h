@@ -1,15 +1,25 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include "Camera.h"
 #include "DisassemblyGraph.h"
+#include "PuzzleFileIndex.h"
+#include "PuzzleGenerator.h"
+#include "PuzzleRenderer.h"
+#include "SolutionCache.h"
 
 class PuzzleDemonstrator
 {
 public:
+    ~PuzzleDemonstrator(); // cancels the solver and the generator
+
     // init
     void Init();
-    void InitVoxelModel();
     void InitShaders();
+    void UpdateCameraUniforms();
 
     // executed per frame
     void Tick(float dt);
@@ -17,30 +27,70 @@ public:
     void RenderPuzzle();
     void RenderMenu();
     void RenderMenu_FPSPanel();
+    void RenderMenu_Profiler();
     void RenderMenu_DasmPlanner();
+    void RenderMenu_Generator();
 
     // miscs
     void DetectPuzzleFiles();
+    bool ImportPuzzle(const std::string &puzzleFilePath);
+    void StartSolving(bool complete); // on the solver thread, the UI keeps running meanwhile
+    void UpdateSolvingState();
+    void StartGenerating(); // on the generator thread, the puzzles are saved to cPuzzleFileFolder
+    void UpdateGeneratingState();
+    void UpdateDisplayedConfig();
 
 private:
     // disassemble planner
+    // while the solver thread builds the graph, the UI only touches it with TryLockGraph (or asks for the progress)
     DisassemblyGraph _DasmGraph;
+    std::thread _SolverThread;
+    std::atomic<bool> _Solving = false;
+    std::chrono::steady_clock::time_point _SolveStartTime;
+    float _SolveTime = 0.0f; // in seconds
+    SolutionCache _SolutionCache;
+    bool _SolutionCached = false; // the plan was loaded on import rather than solved
 
-    // puzzle designer
-    ;
+    // puzzle generator
+    PuzzleGenerator _Generator;
+    PuzzleGeneratorSettings _GeneratorSettings; // the board is made from the two below
+    int _GeneratorBoardSize[2] = {4, 4};
+    int _GeneratorOpeningWidth = 2;
+    std::thread _GeneratorThread;
+    std::atomic<bool> _Generating = false;
+    bool _GeneratorFailed = false; // invalid settings, written by the generator thread before it finishes
 
     // puzzle info
+    std::string _PuzzleFilePath;
     bool _PuzzleImported = false;
     int _CurrentPlanOffset = 0;
     int _CurrentConfigID = 0;
     int _PrevConfigID = -1; // used to detect if the config changes (if so, then we need to correct the position of camera)
 
+    // a copy of the current config, which can be rendered without locking the graph
+    Arena<PuzzlePieceState> _DisplayedStateArena;
+    PuzzleConfig _DisplayedConfig;
+    int _DisplayedConfigID = -1;
+    double _GraphMemoryUsage = 0.0, _GraphMemoryUsagePerNode = 0.0; // the last values seen
+
     // miscs
     float _DeltaTime;
-    std::vector<std::string> _PuzzleFiles;
+    PuzzleFileIndex _PuzzleFileIndex;
+    std::vector<std::string> _PuzzleFiles; // a copy of the index's list, updated only when it changes
+    int _SelectedPuzzleFile = 0;
 
     // rendering
-    VertexBuffer _VoxelModel;
+    PuzzleRenderer _PuzzleRenderer;
+    bool _GreedyMeshing = true; // otherwise the voxels are drawn instanced, see PuzzleRenderer::SetGreedyMeshing
     Shader _BasicShader;
+    bool _Wireframe = false;              // only the outlines of the voxels
+    UniformHandle<int> _WireframeUniform; // resolved in InitShaders, set per draw
+    // the Camera uniform block of the shaders (std140: two mat4 need no padding)
+    struct CameraUniforms
+    {
+        glm::mat4 _View;
+        glm::mat4 _Proj;
+    };
+    UniformBuffer _CameraUniforms;
     Camera _Camera;
 };
@@ -0,0 +1,209 @@
+#include "PuzzleFile.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "Logger.h"
+
+#include "HLP_Config.h"
+
+PuzzleFileFormat DetectPuzzleFileFormat(const std::string &puzzleFilePath)
+{
+    std::ifstream fin(puzzleFilePath, std::ios::binary);
+    if (!fin)
+    {
+        return PuzzleFileFormat::INVALID;
+    }
+
+    // the magic number in binary never looks like digits, so the first 4 bytes tell the formats apart
+    std::int32_t magicNumber = 0;
+    if (fin.read(reinterpret_cast<char *>(&magicNumber), sizeof(magicNumber)) && magicNumber == cPuzzleFileMagicNumber)
+    {
+        return PuzzleFileFormat::BINARY;
+    }
+
+    fin.clear();
+    fin.seekg(0);
+    int textMagicNumber = 0;
+    fin >> textMagicNumber;
+
+    return textMagicNumber == cPuzzleFileMagicNumber ? PuzzleFileFormat::TEXT : PuzzleFileFormat::INVALID;
+}
+
+bool ReadTextPuzzleFile(const std::string &puzzleFilePath, std::vector<PuzzlePiece> &pieces)
+{
+    std::ifstream fin(puzzleFilePath);
+    if (!fin)
+    {
+        LOG_ERROR("Unable to open the configuation file!");
+        return false;
+    }
+
+    // check if the file is valid
+    int magicNumber = 0;
+    fin >> magicNumber;
+    if (magicNumber != cPuzzleFileMagicNumber)
+    {
+        LOG_ERROR("This is not a valid configuration file!");
+        return false;
+    }
+
+    // the number of pieces is not limited by the file formats, the solver checks it on import
+    int pieceNum = 0;
+    fin >> pieceNum;
+    if (pieceNum <= 0)
+    {
+        LOG_ERROR("This is not a valid configuration file!");
+        return false;
+    }
+
+    // load each puzzle piece
+    pieces.assign(pieceNum, PuzzlePiece());
+    for (auto &piece : pieces)
+    {
+        int voxelNum = 0, x = 0, z = 0;
+        fin >> voxelNum;
+
+        for (int j = 0; j < voxelNum; j++)
+        {
+            fin >> x >> z;
+            piece._Voxels.emplace_back(x, z);
+        }
+    }
+
+    if (!fin)
+    {
+        LOG_ERROR("The configuration file is truncated!");
+        return false;
+    }
+
+    return true;
+}
+
+bool WriteTextPuzzleFile(const std::string &puzzleFilePath, const std::vector<PuzzlePiece> &pieces)
+{
+    std::ofstream fout(puzzleFilePath);
+    if (!fout)
+    {
+        LOG_ERROR("Unable to create the puzzle file %s!", puzzleFilePath.c_str());
+        return false;
+    }
+
+    // the same layout as the hand-made files: blank lines between the header and the pieces
+    fout << cPuzzleFileMagicNumber << "\n\n" << pieces.size() << '\n';
+    for (auto &piece : pieces)
+    {
+        fout << '\n' << piece._Voxels.size() << '\n';
+        for (auto &voxel : piece._Voxels)
+        {
+            fout << voxel._X << ' ' << voxel._Z << '\n';
+        }
+    }
+
+    if (!fout)
+    {
+        LOG_ERROR("Failed to write the puzzle file %s!", puzzleFilePath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool WriteBinaryPuzzleFile(const std::string &puzzleFilePath, const std::vector<PuzzlePiece> &pieces)
+{
+    std::ofstream fout(puzzleFilePath, std::ios::binary);
+    if (!fout)
+    {
+        LOG_ERROR("Unable to create the puzzle file %s!", puzzleFilePath.c_str());
+        return false;
+    }
+
+    PuzzleFileHeader header = {cPuzzleFileMagicNumber, cPuzzleFileVersion, static_cast<std::uint32_t>(pieces.size()), 0};
+    std::vector<PuzzleFilePieceEntry> pieceTable;
+    for (auto &piece : pieces)
+    {
+        pieceTable.push_back({header._VoxelNum, static_cast<std::uint32_t>(piece._Voxels.size())});
+        header._VoxelNum += piece._Voxels.size();
+    }
+
+    fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char *>(pieceTable.data()), pieceTable.size() * sizeof(PuzzleFilePieceEntry));
+    for (auto &piece : pieces)
+    {
+        fout.write(reinterpret_cast<const char *>(piece._Voxels.data()), piece._Voxels.size() * sizeof(Voxel));
+    }
+
+    if (!fout)
+    {
+        LOG_ERROR("Failed to write the puzzle file %s!", puzzleFilePath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool MapBinaryPuzzleFile(const std::string &puzzleFilePath, PuzzleGeometry &geometry)
+{
+    MappedFile puzzleFile;
+    if (!puzzleFile.Open(puzzleFilePath))
+    {
+        LOG_ERROR("Unable to open the configuation file!");
+        return false;
+    }
+
+    // everything is checked against the file size before use, the file may be truncated or not a puzzle at all
+    PuzzleFileHeader header;
+    if (puzzleFile.GetSize() < sizeof(header))
+    {
+        LOG_ERROR("The configuration file is truncated!");
+        return false;
+    }
+    std::memcpy(&header, puzzleFile.GetData(), sizeof(header));
+
+    if (header._MagicNumber != cPuzzleFileMagicNumber)
+    {
+        LOG_ERROR("This is not a valid configuration file!");
+        return false;
+    }
+
+    if (header._Version != cPuzzleFileVersion)
+    {
+        LOG_ERROR("Unsupported puzzle file version %u! (expected %u)", header._Version, cPuzzleFileVersion);
+        return false;
+    }
+
+    if (header._PieceNum == 0)
+    {
+        LOG_ERROR("This is not a valid configuration file!");
+        return false;
+    }
+
+    std::size_t pieceTableOffset = sizeof(header);
+    std::size_t voxelArrayOffset = pieceTableOffset + std::size_t(header._PieceNum) * sizeof(PuzzleFilePieceEntry);
+    if (puzzleFile.GetSize() < voxelArrayOffset + std::size_t(header._VoxelNum) * sizeof(Voxel))
+    {
+        LOG_ERROR("The configuration file is truncated!");
+        return false;
+    }
+
+    auto pieceTable = reinterpret_cast<const PuzzleFilePieceEntry *>(puzzleFile.GetData() + pieceTableOffset);
+    auto voxels = reinterpret_cast<const Voxel *>(puzzleFile.GetData() + voxelArrayOffset);
+
+    geometry._Pieces.resize(header._PieceNum);
+    for (std::uint32_t i = 0; i < header._PieceNum; i++)
+    {
+        auto &entry = pieceTable[i];
+        if (entry._VoxelOffset > header._VoxelNum || entry._VoxelNum > header._VoxelNum - entry._VoxelOffset)
+        {
+            LOG_ERROR("The piece table of the configuration file is corrupted!");
+            return false;
+        }
+
+        geometry._Pieces[i]._Voxels = std::span(voxels + entry._VoxelOffset, entry._VoxelNum);
+    }
+
+    geometry._Voxels.clear();
+    geometry._PuzzleFile = std::move(puzzleFile); // the mapping moves along, the spans stay valid
+
+    return true;
+}
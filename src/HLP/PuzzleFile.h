@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PuzzlePiece.h"
+
+// puzzle files, both formats start with cPuzzleFileMagicNumber
+// text:   magic number, piece num, then for each piece: voxel num and the voxels ("x z"), all separated by whitespace
+// binary: PuzzleFileHeader, PuzzleFilePieceEntry[piece num], Voxel[voxel num]
+//         little-endian 32-bit fields, made to be mapped: the voxels are used in place, nothing is parsed
+enum class PuzzleFileFormat
+{
+    INVALID,
+    TEXT,
+    BINARY
+};
+
+constexpr std::uint32_t cPuzzleFileVersion = 1; // of the binary format
+
+struct PuzzleFileHeader
+{
+    std::int32_t _MagicNumber;
+    std::uint32_t _Version;
+    std::uint32_t _PieceNum;
+    std::uint32_t _VoxelNum; // of all pieces
+};
+
+struct PuzzleFilePieceEntry
+{
+    std::uint32_t _VoxelOffset; // in voxels, from the start of the voxel array
+    std::uint32_t _VoxelNum;
+};
+
+// the voxel array starts right after the piece table, so every field stays 4-byte aligned
+static_assert(sizeof(PuzzleFileHeader) == 16 && sizeof(PuzzleFilePieceEntry) == 8);
+static_assert(sizeof(Voxel) == 8 && std::is_standard_layout_v<Voxel>, "voxels are mapped as two int32");
+
+PuzzleFileFormat DetectPuzzleFileFormat(const std::string &puzzleFilePath);
+
+bool ReadTextPuzzleFile(const std::string &puzzleFilePath, std::vector<PuzzlePiece> &pieces);
+bool WriteTextPuzzleFile(const std::string &puzzleFilePath, const std::vector<PuzzlePiece> &pieces);
+bool WriteBinaryPuzzleFile(const std::string &puzzleFilePath, const std::vector<PuzzlePiece> &pieces);
+// the pieces of the geometry refer to the voxels in the mapped file, which is kept by the geometry
+bool MapBinaryPuzzleFile(const std::string &puzzleFilePath, PuzzleGeometry &geometry);
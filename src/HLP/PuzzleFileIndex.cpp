@@ -0,0 +1,213 @@
+#include "PuzzleFileIndex.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Logger.h"
+
+#include "PuzzleFile.h"
+
+PuzzleFileIndex::~PuzzleFileIndex()
+{
+    _Unwatch();
+}
+
+void PuzzleFileIndex::Init(const std::string &folderPath)
+{
+    _Unwatch();
+    _FolderPath = folderPath;
+    _Entries.clear();
+    if (!fs::exists(folderPath))
+    {
+        LOG_WARNING("The folder %s does not exist!", folderPath.c_str());
+    }
+    _PuzzleFiles.clear();
+
+    // watch first, so that nothing changed while listing is missed
+    _Watch();
+    _Rescan();
+    _UpdatePuzzleFiles();
+}
+
+bool PuzzleFileIndex::Refresh()
+{
+    if (_WatchFD == -1)
+    {
+        // not watched (or the watch was lost): poll, and try to watch again
+        _Watch();
+        _Rescan();
+        return _UpdatePuzzleFiles();
+    }
+
+#ifdef __linux__
+    std::unordered_set<std::string> changedFileNames;
+    bool rescan = false;
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length = 0;
+    while ((length = read(_InotifyFD, buffer, sizeof(buffer))) > 0) // non-blocking, fails with EAGAIN when there are no events
+    {
+        const inotify_event *event = nullptr;
+        for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + event->len)
+        {
+            event = reinterpret_cast<const inotify_event *>(ptr);
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                rescan = true;
+            }
+            else if (event->wd != _WatchFD) // left over from a watch which was removed
+            {
+                continue;
+            }
+            else if (event->mask & IN_IGNORED) // the folder is gone
+            {
+                _WatchFD = -1;
+                rescan = true;
+            }
+            else if (event->mask & IN_MOVE_SELF)
+            {
+                // the watch would follow the folder to its new name: drop it, poll and watch the path again once it exists
+                inotify_rm_watch(_InotifyFD, _WatchFD);
+                _WatchFD = -1;
+                rescan = true;
+            }
+            else if (event->mask & IN_DELETE_SELF)
+            {
+                rescan = true;
+            }
+            else if (event->len > 0 && !(event->mask & IN_ISDIR))
+            {
+                changedFileNames.insert(event->name);
+            }
+        }
+    }
+
+    if (rescan)
+    {
+        _Rescan();
+    }
+    else
+    {
+        for (auto &fileName : changedFileNames)
+        {
+            _UpdateEntry(fileName);
+        }
+    }
+
+    return (rescan || !changedFileNames.empty()) && _UpdatePuzzleFiles();
+#else
+    return false;
+#endif
+}
+
+const std::vector<std::string> &PuzzleFileIndex::GetPuzzleFiles() const
+{
+    return _PuzzleFiles;
+}
+
+void PuzzleFileIndex::_Watch()
+{
+#ifdef __linux__
+    if (_InotifyFD == -1)
+    {
+        _InotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+
+    if (_InotifyFD != -1 && _WatchFD == -1)
+    {
+        // IN_CLOSE_WRITE instead of IN_MODIFY: a file is checked once it's completely written
+        auto mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+        _WatchFD = inotify_add_watch(_InotifyFD, _FolderPath.c_str(), mask);
+    }
+#endif
+}
+
+void PuzzleFileIndex::_Unwatch()
+{
+#ifdef __linux__
+    if (_InotifyFD != -1)
+    {
+        close(_InotifyFD); // removes the watch as well
+    }
+#endif
+
+    _InotifyFD = _WatchFD = -1;
+}
+
+void PuzzleFileIndex::_Rescan()
+{
+    std::unordered_set<std::string> fileNames;
+
+    std::error_code error;
+    for (fs::directory_iterator iter(_FolderPath, error), end; !error && iter != end; iter.increment(error))
+    {
+        if (!iter->is_directory(error))
+        {
+            fileNames.insert(iter->path().filename().string());
+        }
+    }
+
+    std::erase_if(_Entries, [&](const auto &entry) { return !fileNames.contains(entry.first); });
+    for (auto &fileName : fileNames)
+    {
+        _UpdateEntry(fileName);
+    }
+}
+
+void PuzzleFileIndex::_UpdateEntry(const std::string &fileName)
+{
+    auto filePath = fs::path(_FolderPath) / fileName;
+
+    std::error_code error;
+    auto status = fs::status(filePath, error);
+    if (error || !fs::is_regular_file(status))
+    {
+        _Entries.erase(fileName);
+        return;
+    }
+
+    auto writeTime = fs::last_write_time(filePath, error);
+    auto size = fs::file_size(filePath, error);
+    if (error)
+    {
+        _Entries.erase(fileName);
+        return;
+    }
+
+    auto [iter, inserted] = _Entries.try_emplace(fileName);
+    auto &entry = iter->second;
+    if (inserted || entry._WriteTime != writeTime || entry._Size != size)
+    {
+        entry._WriteTime = writeTime;
+        entry._Size = size;
+        entry._IsPuzzleFile = DetectPuzzleFileFormat(filePath.string()) != PuzzleFileFormat::INVALID;
+    }
+}
+
+bool PuzzleFileIndex::_UpdatePuzzleFiles()
+{
+    std::vector<std::string> puzzleFiles;
+    for (auto &[fileName, entry] : _Entries)
+    {
+        if (entry._IsPuzzleFile)
+        {
+            puzzleFiles.push_back(fileName);
+        }
+    }
+    std::sort(puzzleFiles.begin(), puzzleFiles.end());
+
+    if (puzzleFiles == _PuzzleFiles)
+    {
+        return false;
+    }
+
+    _PuzzleFiles = std::move(puzzleFiles);
+    DLOG_INFO("%zu puzzle file(s) in %s", _PuzzleFiles.size(), _FolderPath.c_str());
+
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Utils.h"
+
+// the puzzle files of a folder, kept up to date incrementally instead of reading every file again
+// a file is only re-checked (its header read) if its write time or size changed
+// on linux, inotify tells which files changed, so a refresh without changes costs a single (non-blocking) read
+// elsewhere (or if the folder can't be watched) a refresh lists the folder, but still doesn't open unchanged files
+class PuzzleFileIndex
+{
+public:
+    PuzzleFileIndex() = default;
+    PuzzleFileIndex(const PuzzleFileIndex &) = delete;
+    PuzzleFileIndex &operator=(const PuzzleFileIndex &) = delete;
+    ~PuzzleFileIndex();
+
+    void Init(const std::string &folderPath);
+    bool Refresh(); // returns true if the list of puzzle files changed
+
+    const std::vector<std::string> &GetPuzzleFiles() const; // file names, sorted
+
+private:
+    struct FileEntry
+    {
+        fs::file_time_type _WriteTime;
+        std::uintmax_t _Size = 0;
+        bool _IsPuzzleFile = false;
+    };
+
+    void _Watch();
+    void _Unwatch();
+    void _Rescan();
+    void _UpdateEntry(const std::string &fileName); // (re)checks the file if it changed, forgets it if it's gone
+    bool _UpdatePuzzleFiles();
+
+private:
+    std::string _FolderPath;
+    std::unordered_map<std::string, FileEntry> _Entries; // by file name
+    std::vector<std::string> _PuzzleFiles;
+
+    int _InotifyFD = -1; // linux only
+    int _WatchFD = -1;
+};
@@ -0,0 +1,395 @@
+#include "PuzzleGenerator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#include "Logger.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+
+#include "DisassemblyGraph.h"
+#include "HLP_Config.h"
+
+namespace {
+    constexpr std::int16_t cEmptyCell = -1;
+    constexpr std::int16_t cOffBoard = -2;
+    constexpr std::int16_t cUnassigned = -3; // while the regions grow
+    constexpr int cMaxMutationNum = 3;      // per candidate
+    constexpr int cMaxMutationAttempts = 32;
+
+    constexpr int cDirX[4] = {0, 0, -1, 1};
+    constexpr int cDirZ[4] = {-1, 1, 0, 0};
+} // namespace
+
+BoardShape BoardShape::MakeRectangle(int sizeX, int sizeZ, int openingWidth)
+{
+    sizeX = std::max(sizeX, 0);
+    sizeZ = std::max(sizeZ, 0);
+    int frameWidth = (openingWidth > 0) ? 1 : 0;
+
+    BoardShape board;
+    board._SizeX = sizeX + frameWidth * 2;
+    board._SizeZ = sizeZ + frameWidth * 2;
+    board._Cells.assign(board._SizeX * board._SizeZ, FRAME);
+    for (int x = 0; x < board._SizeX; x++)
+    {
+        for (int z = 0; z < board._SizeZ; z++)
+        {
+            bool inside = x >= frameWidth && x < sizeX + frameWidth && z >= frameWidth && z < sizeZ + frameWidth;
+            bool opening = z == 0 && std::abs(2 * x - (board._SizeX - 1)) < openingWidth; // centered
+            board._Cells[x * board._SizeZ + z] = inside ? FREE : (opening ? NONE : FRAME);
+        }
+    }
+
+    return board;
+}
+
+int BoardShape::GetCellNum(Cell cell) const
+{
+    return std::count(_Cells.begin(), _Cells.end(), cell);
+}
+
+double PuzzleGeneratorStats::GetCandidatesPerSecond() const
+{
+    return _Time > 0.0 ? _CandidateNum / _Time : 0.0;
+}
+
+bool PuzzleGenerator::Generate(const PuzzleGeneratorSettings &settings, const PuzzleCallback &onPuzzle)
+{
+    auto &board = settings._Board;
+    if (board._SizeX <= 0 || board._SizeZ <= 0 || static_cast<int>(board._Cells.size()) != board._SizeX * board._SizeZ)
+    {
+        LOG_ERROR("Invalid board of %d x %d cells", board._SizeX, board._SizeZ);
+        return false;
+    }
+    int framePieceNum = board.GetCellNum(BoardShape::FRAME) > 0 ? 1 : 0;
+    if (settings._PieceNum + framePieceNum < 2 || settings._PieceNum + framePieceNum > cMaxPieceNum || settings._EmptyCellNum < 0 ||
+        board.GetCellNum() - settings._EmptyCellNum < settings._PieceNum)
+    {
+        LOG_ERROR("%d puzzle pieces and %d empty cells don't fit a board of %d cells", settings._PieceNum, settings._EmptyCellNum,
+                  board.GetCellNum());
+        return false;
+    }
+    if (settings._TargetDifficulty < 1)
+    {
+        LOG_ERROR("The target difficulty must be at least 1");
+        return false;
+    }
+
+    _Settings = settings;
+    _BoardCells.clear();
+    for (int i = 0; i < static_cast<int>(board._Cells.size()); i++)
+    {
+        if (board._Cells[i] == BoardShape::FREE)
+        {
+            _BoardCells.push_back(i);
+        }
+    }
+
+    _CancelRequested = false;
+    _CandidateNum = _AcceptedNum = _TooEasyNum = _OverBudgetNum = _UnsolvableNum = _DuplicateNum = 0;
+    _Elites.clear();
+    _AcceptedHashes.clear();
+    {
+        std::lock_guard lock(_TimeMutex);
+        _StartTime = std::chrono::steady_clock::now();
+        _Generating = true;
+    }
+
+    // each worker runs until the generator is done, so there are never more workers than threads
+    gThreadPool.Init();
+    int workerNum = (_Settings._WorkerNum > 0) ? std::min(_Settings._WorkerNum, gThreadPool.GetThreadNum()) : gThreadPool.GetThreadNum();
+    gThreadPool.ParallelFor(workerNum, [&](int workerIndex) { _Work(workerIndex, onPuzzle); });
+
+    {
+        std::lock_guard lock(_TimeMutex);
+        _Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - _StartTime).count();
+        _Generating = false;
+    }
+
+    LOG_INFO("Generated %lld puzzle(s) of difficulty %d, %lld candidate(s) in %.2f s", (long long)_AcceptedNum.load(),
+             _Settings._TargetDifficulty, (long long)_CandidateNum.load(), _Time);
+
+    return true;
+}
+
+void PuzzleGenerator::Cancel()
+{
+    _CancelRequested = true;
+}
+
+PuzzleGeneratorStats PuzzleGenerator::GetStats() const
+{
+    PuzzleGeneratorStats stats;
+    stats._CandidateNum = _CandidateNum;
+    stats._AcceptedNum = _AcceptedNum;
+    stats._TooEasyNum = _TooEasyNum;
+    stats._OverBudgetNum = _OverBudgetNum;
+    stats._UnsolvableNum = _UnsolvableNum;
+    stats._DuplicateNum = _DuplicateNum;
+
+    std::lock_guard lock(_TimeMutex);
+    stats._Time = _Generating ? std::chrono::duration<double>(std::chrono::steady_clock::now() - _StartTime).count() : _Time;
+
+    return stats;
+}
+
+bool PuzzleGenerator::_ProposeRandomPartition(std::mt19937_64 &rng, Partition &partition) const
+{
+    auto &board = _Settings._Board;
+    partition.assign(board._Cells.size(), cOffBoard);
+    for (int i = 0; i < static_cast<int>(board._Cells.size()); i++)
+    {
+        if (board._Cells[i] == BoardShape::FRAME)
+        {
+            partition[i] = _Settings._PieceNum;
+        }
+    }
+
+    // the first cells of the shuffled board are left empty, the next ones are the seeds of the pieces
+    // (not std::shuffle, it's implementation-defined like the std distributions, see _WorkerNum)
+    auto cells = _BoardCells;
+    for (int i = static_cast<int>(cells.size()) - 1; i > 0; i--)
+    {
+        std::swap(cells[i], cells[rng() % (i + 1)]);
+    }
+    int emptyCellNum = _Settings._EmptyCellNum, pieceNum = _Settings._PieceNum;
+    for (int i = 0; i < static_cast<int>(cells.size()); i++)
+    {
+        partition[cells[i]] = (i < emptyCellNum) ? cEmptyCell : cUnassigned;
+    }
+
+    // the pieces grow from their seeds, one random cell of the whole frontier at a time
+    std::vector<std::pair<int, int>> frontier; // <cell, piece>
+    auto Grow = [&](int cell, int piece) {
+        partition[cell] = piece;
+        int x = cell / board._SizeZ, z = cell % board._SizeZ;
+        for (int dir = 0; dir < 4; dir++)
+        {
+            int nx = x + cDirX[dir], nz = z + cDirZ[dir];
+            if (nx >= 0 && nx < board._SizeX && nz >= 0 && nz < board._SizeZ && partition[nx * board._SizeZ + nz] == cUnassigned)
+            {
+                frontier.emplace_back(nx * board._SizeZ + nz, piece);
+            }
+        }
+    };
+
+    for (int piece = 0; piece < pieceNum; piece++)
+    {
+        Grow(cells[emptyCellNum + piece], piece);
+    }
+
+    while (!frontier.empty())
+    {
+        std::swap(frontier[rng() % frontier.size()], frontier.back());
+        auto [cell, piece] = frontier.back();
+        frontier.pop_back();
+        if (partition[cell] == cUnassigned)
+        {
+            Grow(cell, piece);
+        }
+    }
+
+    // the empty cells may cut off a part of the board without any seed
+    return std::find(partition.begin(), partition.end(), cUnassigned) == partition.end();
+}
+
+bool PuzzleGenerator::_Mutate(std::mt19937_64 &rng, Partition &partition) const
+{
+    auto &board = _Settings._Board;
+
+    for (int attempt = 0; attempt < cMaxMutationAttempts; attempt++)
+    {
+        int cell = _BoardCells[rng() % _BoardCells.size()], dir = rng() % 4;
+        int nx = cell / board._SizeZ + cDirX[dir], nz = cell % board._SizeZ + cDirZ[dir];
+        if (nx < 0 || nx >= board._SizeX || nz < 0 || nz >= board._SizeZ)
+        {
+            continue;
+        }
+
+        int neighbor = nx * board._SizeZ + nz;
+        std::int16_t piece = partition[cell], neighborOwner = partition[neighbor];
+        if (piece < 0 || neighborOwner == piece || neighborOwner == cOffBoard || neighborOwner == _Settings._PieceNum) // the frame stays
+        {
+            continue;
+        }
+
+        // the cell goes to the neighboring piece, or slides into the neighboring empty cell (the number of empty cells stays)
+        // either way, only the piece which loses the cell may fall apart
+        if (neighborOwner == cEmptyCell)
+        {
+            partition[neighbor] = piece;
+            partition[cell] = cEmptyCell;
+        }
+        else
+        {
+            partition[cell] = neighborOwner;
+        }
+
+        if (_IsPieceConnected(partition, piece))
+        {
+            return true;
+        }
+
+        partition[cell] = piece;
+        partition[neighbor] = neighborOwner;
+    }
+
+    return false;
+}
+
+bool PuzzleGenerator::_IsPieceConnected(const Partition &partition, int piece) const
+{
+    auto &board = _Settings._Board;
+
+    auto first = std::find(partition.begin(), partition.end(), piece);
+    if (first == partition.end())
+    {
+        return false;
+    }
+
+    std::vector<std::uint8_t> visited(partition.size(), 0);
+    std::vector<int> stack = {static_cast<int>(first - partition.begin())};
+    visited[stack.back()] = 1;
+    int visitedNum = 0;
+    while (!stack.empty())
+    {
+        int cell = stack.back();
+        stack.pop_back();
+        visitedNum++;
+
+        int x = cell / board._SizeZ, z = cell % board._SizeZ;
+        for (int dir = 0; dir < 4; dir++)
+        {
+            int nx = x + cDirX[dir], nz = z + cDirZ[dir];
+            int neighbor = nx * board._SizeZ + nz;
+            if (nx >= 0 && nx < board._SizeX && nz >= 0 && nz < board._SizeZ && !visited[neighbor] && partition[neighbor] == piece)
+            {
+                visited[neighbor] = 1;
+                stack.push_back(neighbor);
+            }
+        }
+    }
+
+    return visitedNum == std::count(partition.begin(), partition.end(), piece);
+}
+
+std::vector<PuzzlePiece> PuzzleGenerator::_MakePieces(const Partition &partition) const
+{
+    // the pieces are numbered by their first cell, so the same puzzle always has the same pieces (and hash)
+    std::vector<PuzzlePiece> pieces;
+    std::vector<int> pieceIDs(_Settings._PieceNum + 1, -1);
+    for (int cell = 0; cell < static_cast<int>(partition.size()); cell++)
+    {
+        int owner = partition[cell];
+        if (owner < 0)
+        {
+            continue;
+        }
+
+        if (pieceIDs[owner] == -1)
+        {
+            pieceIDs[owner] = pieces.size();
+            pieces.emplace_back();
+        }
+        pieces[pieceIDs[owner]]._Voxels.emplace_back(cell / _Settings._Board._SizeZ, cell % _Settings._Board._SizeZ);
+    }
+
+    return pieces;
+}
+
+void PuzzleGenerator::_AddElite(std::mt19937_64 &rng, const Partition &partition, int difficulty)
+{
+    std::lock_guard lock(_EliteMutex);
+    if (static_cast<int>(_Elites.size()) < cGeneratorEliteNum)
+    {
+        _Elites.push_back({partition, difficulty});
+        return;
+    }
+
+    // a random one is replaced unless it's harder, so the pool drifts towards the target but stays diverse
+    auto &elite = _Elites[rng() % _Elites.size()];
+    if (elite._Difficulty <= difficulty)
+    {
+        elite = {partition, difficulty};
+    }
+}
+
+bool PuzzleGenerator::_PickElite(std::mt19937_64 &rng, Partition &partition)
+{
+    std::lock_guard lock(_EliteMutex);
+    if (_Elites.empty())
+    {
+        return false;
+    }
+
+    partition = _Elites[rng() % _Elites.size()]._Partition;
+    return true;
+}
+
+void PuzzleGenerator::_Work(int workerIndex, const PuzzleCallback &onPuzzle)
+{
+    std::mt19937_64 rng(Mix64(_Settings._Seed + workerIndex));
+    auto Chance = [&]() { return (rng() >> 40) / float(1 << 24); }; // [0, 1)
+
+    // the graph is reused by all candidates of the worker, the pool is busy with the other workers anyway
+    int targetDifficulty = _Settings._TargetDifficulty;
+    DisassemblyGraph graph;
+    graph.SetParallelBuild(false);
+    graph.SetSearchBudget(targetDifficulty, _Settings._MaxExpandedNum);
+
+    auto IsDone = [&]() {
+        return _CancelRequested.load(std::memory_order_relaxed) || (_Settings._PuzzleNum > 0 && _AcceptedNum >= _Settings._PuzzleNum);
+    };
+
+    Partition partition;
+    while (!IsDone())
+    {
+        bool mutated = Chance() < _Settings._MutationRate && _PickElite(rng, partition);
+        for (int i = rng() % cMaxMutationNum; mutated && i >= 0; i--)
+        {
+            mutated = _Mutate(rng, partition);
+        }
+        if (!mutated && !_ProposeRandomPartition(rng, partition))
+        {
+            continue;
+        }
+
+        if (!graph.ImportPuzzle(_MakePieces(partition)))
+        {
+            continue;
+        }
+        bool solved = graph.BuildKernelDisassemblyGraph();
+        _CandidateNum++;
+
+        if (!solved)
+        {
+            (graph.IsSearchBudgetExceeded() ? _OverBudgetNum : _UnsolvableNum)++;
+            continue;
+        }
+
+        // a deeper one would have exceeded the budget
+        int difficulty = graph.GetPuzzleDifficulty();
+        _AddElite(rng, partition, difficulty);
+        if (difficulty < targetDifficulty)
+        {
+            _TooEasyNum++;
+            continue;
+        }
+
+        std::lock_guard lock(_AcceptMutex);
+        if (IsDone())
+        {
+            break;
+        }
+        if (!_AcceptedHashes.insert(graph.GetPuzzleHash()).second)
+        {
+            _DuplicateNum++;
+            continue;
+        }
+
+        _AcceptedNum++;
+        onPuzzle(_MakePieces(partition), graph.GetPuzzleHash());
+    }
+}
@@ -1,6 +1,120 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "PuzzlePiece.h"
+
+// the cells of a generated puzzle, the cell (x, z) becomes the voxel (x, z)
+// the free cells are split among the pieces (or left empty), the frame cells are one more piece which holds them together
+// (without a frame, nothing keeps the pieces from sliding out right away)
+struct BoardShape
+{
+    enum Cell : std::uint8_t
+    {
+        NONE,
+        FREE,
+        FRAME
+    };
+
+    // sizeX x sizeZ free cells, surrounded by a frame with an opening of openingWidth cells in the middle of its top side
+    // openingWidth = 0: no frame
+    static BoardShape MakeRectangle(int sizeX, int sizeZ, int openingWidth = 0);
+    int GetCellNum(Cell cell = FREE) const;
+
+    int _SizeX = 0;
+    int _SizeZ = 0;
+    std::vector<Cell> _Cells; // [x * _SizeZ + z]
+};
+
+struct PuzzleGeneratorSettings
+{
+    BoardShape _Board = BoardShape::MakeRectangle(4, 4, 2);
+    int _PieceNum = 5;           // the free cells are split into, the frame is one more
+    int _EmptyCellNum = 2;       // free cells left empty, the room the pieces have to move
+    int _TargetDifficulty = 4;   // the kernel depth of the generated puzzles, see DisassemblyGraph::GetPuzzleDifficulty
+    int _MaxExpandedNum = 20000; // configs a candidate may expand before it's rejected (0: no limit)
+    int _PuzzleNum = 1;          // stop after so many puzzles (0: until cancelled)
+    float _MutationRate = 0.75f; // how often a candidate is a mutation of a promising one rather than a new partition
+    std::uint64_t _Seed = 0;
+    int _WorkerNum = 0; // 0: one per thread of the pool, 1: the same seed always generates the same puzzles (on any platform)
+};
+
+// all counters are of candidates, i.e. of puzzles given to the solver
+struct PuzzleGeneratorStats
+{
+    std::int64_t _CandidateNum = 0;
+    std::int64_t _AcceptedNum = 0;
+    std::int64_t _TooEasyNum = 0;    // a removal within less than the target depth
+    std::int64_t _OverBudgetNum = 0; // no removal within the target depth, or too many configs expanded
+    std::int64_t _UnsolvableNum = 0; // nothing can ever be removed
+    std::int64_t _DuplicateNum = 0;  // of a puzzle accepted before
+    double _Time = 0.0;              // in seconds
+
+    double GetCandidatesPerSecond() const;
+};
+
+// proposes partitions of the free cells of the board into connected pieces and keeps the ones of exactly the target difficulty
+// a candidate is a random partition (regions grown from random seeds) or a mutation of a candidate which came close:
+// a cell moved to a neighboring piece, or an empty cell swapped with a cell of a piece
+// every candidate is solved by a kernel BFS of its own, which gives up as soon as the candidate is known to be too hard
+// (no removal within the target depth) or too costly (the expansion budget), so the rejects are cheap
+// the workers run on the thread pool, each builds one graph at a time on its own thread (parallel over the candidates,
+// not over the levels, there is no synchronization per level)
 class PuzzleGenerator
 {
 public:
+    // the pieces in a canonical order (by their first cell), hash: DisassemblyGraph::GetPuzzleHash of them
+    using PuzzleCallback = std::function<void(std::vector<PuzzlePiece> &&pieces, std::uint64_t hash)>;
+
+    // returns once settings._PuzzleNum puzzles are generated or Cancel is called, false if the settings are invalid
+    // onPuzzle is called on the worker which found the puzzle, one puzzle at a time
+    bool Generate(const PuzzleGeneratorSettings &settings, const PuzzleCallback &onPuzzle);
+
+    // safe to call from any thread meanwhile
+    void Cancel();
+    PuzzleGeneratorStats GetStats() const; // of the current (or last) Generate
+
+private:
+    // the owner of each cell of the board: a piece (the frame is piece _PieceNum), cEmptyCell or cOffBoard
+    using Partition = std::vector<std::int16_t>;
+
+    struct Elite
+    {
+        Partition _Partition;
+        int _Difficulty = 0;
+    };
+
+    bool _ProposeRandomPartition(std::mt19937_64 &rng, Partition &partition) const; // false if the regions didn't cover the board
+    bool _Mutate(std::mt19937_64 &rng, Partition &partition) const;                 // false if no mutation was possible
+    bool _IsPieceConnected(const Partition &partition, int piece) const;
+    std::vector<PuzzlePiece> _MakePieces(const Partition &partition) const;
+    void _AddElite(std::mt19937_64 &rng, const Partition &partition, int difficulty);
+    bool _PickElite(std::mt19937_64 &rng, Partition &partition);
+    void _Work(int workerIndex, const PuzzleCallback &onPuzzle);
+
+private:
+    PuzzleGeneratorSettings _Settings;
+    std::vector<int> _BoardCells; // the indices of the free cells of the board
+
+    std::atomic<bool> _CancelRequested = false;
+    std::atomic<bool> _Generating = false;
+    std::atomic<std::int64_t> _CandidateNum = 0, _AcceptedNum = 0, _TooEasyNum = 0, _OverBudgetNum = 0, _UnsolvableNum = 0,
+                              _DuplicateNum = 0;
+    mutable std::mutex _TimeMutex;
+    std::chrono::steady_clock::time_point _StartTime;
+    double _Time = 0.0; // of the last Generate, once it's finished
+
+    // the candidates which came closest to the target, the parents of the mutations
+    std::mutex _EliteMutex;
+    std::vector<Elite> _Elites;
+
+    std::mutex _AcceptMutex;
+    std::unordered_set<std::uint64_t> _AcceptedHashes;
 };
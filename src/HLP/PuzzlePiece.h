@@ -1,12 +1,221 @@
 #pragma once
 
-#include <memory>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <span>
 #include <vector>
 
-#include <glm/glm.hpp>
-
+#include "HLP_Config.h"
+#include "Utils.h"
 #include "Voxel.h"
 
+// bit i is set <=> the piece with ID i is included
+// a fixed number of 64-bit words (see cMaxPieceNum), so it's still a plain value: no allocation, trivially copyable
+// for (int pieceID : mask) visits the pieces in ascending order
+class PieceMask
+{
+public:
+    static constexpr int cWordNum = (cMaxPieceNum + 63) / 64;
+    using Words = std::array<std::uint64_t, cWordNum>;
+
+    // visits the set bits, lowest first
+    class Iterator
+    {
+    public:
+        explicit Iterator(const Words &words) : _Words(words)
+        {
+            _SkipEmptyWords();
+        }
+
+        int operator*() const
+        {
+            return _WordIndex * 64 + std::countr_zero(_Words[_WordIndex]);
+        }
+
+        Iterator &operator++()
+        {
+            _Words[_WordIndex] &= _Words[_WordIndex] - 1;
+            _SkipEmptyWords();
+            return *this;
+        }
+
+        bool operator==(std::default_sentinel_t) const
+        {
+            return _WordIndex == cWordNum;
+        }
+
+    private:
+        void _SkipEmptyWords()
+        {
+            while (_WordIndex < cWordNum && !_Words[_WordIndex])
+            {
+                _WordIndex++;
+            }
+        }
+
+        Words _Words;
+        int _WordIndex = 0;
+    };
+
+    PieceMask() = default;
+
+    static PieceMask FromPiece(int pieceID)
+    {
+        PieceMask mask;
+        mask.Add(pieceID);
+        return mask;
+    }
+
+    // the pieces 0 ~ pieceNum - 1
+    static PieceMask FromRange(int pieceNum)
+    {
+        PieceMask mask;
+        for (int i = 0; i < cWordNum; i++)
+        {
+            int bitNum = std::clamp(pieceNum - i * 64, 0, 64);
+            mask._Words[i] = (bitNum == 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << bitNum) - 1);
+        }
+        return mask;
+    }
+
+    bool Contains(int pieceID) const
+    {
+        return (_Words[pieceID >> 6] >> (pieceID & 63)) & 1;
+    }
+
+    void Add(int pieceID)
+    {
+        _Words[pieceID >> 6] |= std::uint64_t(1) << (pieceID & 63);
+    }
+
+    void Remove(int pieceID)
+    {
+        _Words[pieceID >> 6] &= ~(std::uint64_t(1) << (pieceID & 63));
+    }
+
+    bool IsEmpty() const
+    {
+        for (auto word : _Words)
+        {
+            if (word)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    explicit operator bool() const
+    {
+        return !IsEmpty();
+    }
+
+    int GetPieceNum() const
+    {
+        int pieceNum = 0;
+        for (auto word : _Words)
+        {
+            pieceNum += std::popcount(word);
+        }
+        return pieceNum;
+    }
+
+    int GetFirstPiece() const // the lowest piece ID, cWordNum * 64 if empty
+    {
+        for (int i = 0; i < cWordNum; i++)
+        {
+            if (_Words[i])
+            {
+                return i * 64 + std::countr_zero(_Words[i]);
+            }
+        }
+        return cWordNum * 64;
+    }
+
+    void RemoveFirstPiece()
+    {
+        for (auto &word : _Words)
+        {
+            if (word)
+            {
+                word &= word - 1;
+                return;
+            }
+        }
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(_Words);
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return std::default_sentinel;
+    }
+
+    PieceMask operator~() const
+    {
+        PieceMask mask;
+        for (int i = 0; i < cWordNum; i++)
+        {
+            mask._Words[i] = ~_Words[i];
+        }
+        return mask;
+    }
+
+    PieceMask &operator&=(const PieceMask &rhs)
+    {
+        for (int i = 0; i < cWordNum; i++)
+        {
+            _Words[i] &= rhs._Words[i];
+        }
+        return *this;
+    }
+
+    PieceMask &operator|=(const PieceMask &rhs)
+    {
+        for (int i = 0; i < cWordNum; i++)
+        {
+            _Words[i] |= rhs._Words[i];
+        }
+        return *this;
+    }
+
+    PieceMask &operator^=(const PieceMask &rhs)
+    {
+        for (int i = 0; i < cWordNum; i++)
+        {
+            _Words[i] ^= rhs._Words[i];
+        }
+        return *this;
+    }
+
+    friend PieceMask operator&(PieceMask lhs, const PieceMask &rhs)
+    {
+        return lhs &= rhs;
+    }
+
+    friend PieceMask operator|(PieceMask lhs, const PieceMask &rhs)
+    {
+        return lhs |= rhs;
+    }
+
+    friend PieceMask operator^(PieceMask lhs, const PieceMask &rhs)
+    {
+        return lhs ^= rhs;
+    }
+
+    bool operator==(const PieceMask &rhs) const = default;
+
+private:
+    Words _Words = {};
+};
+
+// a piece as it's generated or read from a text puzzle file
 struct PuzzlePiece
 {
     std::vector<Voxel> _Voxels;
@@ -14,7 +223,7 @@ struct PuzzlePiece
 
 struct PuzzlePieceState
 {
-    bool operator==(const PuzzlePieceState &rhs)
+    bool operator==(const PuzzlePieceState &rhs) const
     {
         return _OffsetX == rhs._OffsetX && _OffsetZ == rhs._OffsetZ;
     }
@@ -23,28 +232,43 @@ struct PuzzlePieceState
     int _OffsetZ = 0;
 };
 
-struct PuzzlePieceInfo
+// how a config is reached from its parent config, enough to rebuild it from the parent
+struct PuzzleMove
 {
-    PuzzlePieceInfo() = default;
+    PieceMask _SubasmMask;      // empty for the initial config
+    std::int16_t _Distance = 0; // in voxels
+    std::int8_t _Direction = 0; // 0 ~ 3: BACK, FORWARD, LEFT, RIGHT
+    bool _Removal = false;      // the subassembly is removed in _Direction, _Distance is meaningless
+};
 
-    explicit PuzzlePieceInfo(std::shared_ptr<PuzzlePiece> piece) : _Piece(piece)
+// a piece as the configs see it, the voxels are owned by the geometry (or by the puzzle file it's mapped from)
+struct PuzzlePieceGeometry
+{
+    void CalculateBoundingBox()
     {
-    }
+        _MinX = _MinZ = 0x3f3f3f3f;
+        _MaxX = _MaxZ = -0x3f3f3f3f;
 
-    PuzzlePieceInfo(std::shared_ptr<PuzzlePiece> piece, PuzzlePieceState state) : _Piece(piece), _State(state)
-    {
+        for (auto &voxel : _Voxels)
+        {
+            _MinX = std::min(_MinX, voxel._X);
+            _MinZ = std::min(_MinZ, voxel._Z);
+            _MaxX = std::max(_MaxX, voxel._X);
+            _MaxZ = std::max(_MaxZ, voxel._Z);
+        }
     }
 
-    std::shared_ptr<PuzzlePiece> _Piece;
-    PuzzlePieceState _State;
+    std::span<const Voxel> _Voxels;
+
+    // bounding box of the voxels (without offsets)
+    int _MinX = 0, _MaxX = 0, _MinZ = 0, _MaxZ = 0;
 };
 
-struct PuzzlePieceMaterial
+// everything that never changes between the configs of a puzzle, stored only once per puzzle
+// configs only keep the offsets of the pieces (see PuzzleConfig)
+struct PuzzleGeometry
 {
-    PuzzlePieceMaterial() = default;
-    explicit PuzzlePieceMaterial(glm::vec3 &&color) noexcept : _Color(color)
-    {
-    }
-
-    glm::vec3 _Color;
+    std::vector<PuzzlePieceGeometry> _Pieces; // indexed by piece ID
+    std::vector<Voxel> _Voxels;               // the voxels of all pieces in one block
+    MappedFile _PuzzleFile;                   // ... or in a mapped binary puzzle file, then _Voxels is empty
 };
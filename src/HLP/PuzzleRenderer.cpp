@@ -0,0 +1,254 @@
+#include "PuzzleRenderer.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Logger.h"
+#include "Profiler.h"
+#include "Utils.h"
+
+#include "HLP_Config.h"
+
+void PuzzleRenderer::Init()
+{
+    float vertices[] = {-0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.5f,  -0.5f, -0.5f, 1.0f, 0.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f,
+                        0.5f,  0.5f,  -0.5f, 1.0f, 1.0f, -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f, -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
+
+                        -0.5f, -0.5f, 0.5f,  0.0f, 0.0f, 0.5f,  -0.5f, 0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+                        0.5f,  0.5f,  0.5f,  1.0f, 1.0f, -0.5f, 0.5f,  0.5f,  0.0f, 1.0f, -0.5f, -0.5f, 0.5f,  0.0f, 0.0f,
+
+                        -0.5f, 0.5f,  0.5f,  1.0f, 0.0f, -0.5f, 0.5f,  -0.5f, 1.0f, 1.0f, -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+                        -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, -0.5f, -0.5f, 0.5f,  0.0f, 0.0f, -0.5f, 0.5f,  0.5f,  1.0f, 0.0f,
+
+                        0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f, 0.5f,  -0.5f, -0.5f, 0.0f, 1.0f,
+                        0.5f,  -0.5f, -0.5f, 0.0f, 1.0f, 0.5f,  -0.5f, 0.5f,  0.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+                        -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, 0.5f,  -0.5f, -0.5f, 1.0f, 1.0f, 0.5f,  -0.5f, 0.5f,  1.0f, 0.0f,
+                        0.5f,  -0.5f, 0.5f,  1.0f, 0.0f, -0.5f, -0.5f, 0.5f,  0.0f, 0.0f, -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+
+                        -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+                        0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -0.5f, 0.5f,  0.5f,  0.0f, 0.0f, -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f};
+
+    _VoxelModel.SetData(vertices, sizeof(vertices) / sizeof(float)).SetUsage(0, 3).SetUsage(1, 2).EndSetUsage();
+    // the voxels of a config: position + color per instance, the same locations as the offset and the color of a mesh vertex
+    _VoxelModel.SetInstanceData(nullptr, 0).SetInstanceUsage(3, 3).SetInstanceUsage(2, 3).EndSetInstanceUsage();
+}
+
+void PuzzleRenderer::AssignPuzzlePieceMaterials(int pieceNum)
+{
+    auto GenerateRandomColor = []() {
+        static const std::vector<float> segments = {0, 0.4, 0.7, 1.0};
+        static const std::vector<int> weight = {1, 5, 1};
+
+        // the access violation with this static vector was not the compiler's fault:
+        // RandPiecewiseDist used to pick a segment one past the last one (fixed now)
+        static std::vector<float> res(3);
+
+        RandPiecewiseDist(res, 3, segments, weight);
+
+        return glm::vec3(res[0], res[1], res[2]);
+    };
+
+    // 2024-06-13 UPD:
+    // originally I assigned different materials(colors) to adjacent pieces
+    // but I found it useless now
+    // because if you move some pieces and some of them which are not adjacent before will be adjacent
+    // but you can't re-assign colors for them (or everything will be confusing)
+    // new strategy: every puzzle a piece has different color
+
+    _Materials.resize(pieceNum);
+    for (int i = 0; i < pieceNum; i++)
+    {
+        _Materials[i] = PuzzlePieceMaterial(GenerateRandomColor());
+    }
+
+    // the config IDs belong to the previous puzzle, and the colors are baked into the meshes
+    _MeshCache.clear();
+    _CurrentMesh = nullptr;
+    _InstanceNum = 0;
+}
+
+void PuzzleRenderer::SetGreedyMeshing(bool enabled)
+{
+    _GreedyMeshing = enabled;
+}
+
+void PuzzleRenderer::SetConfig(int configID, PuzzleConfig &config)
+{
+    if (!_GreedyMeshing)
+    {
+        UpdateInstances(config);
+        _CurrentMesh = nullptr;
+        return;
+    }
+
+    auto iter = _MeshCache.find(configID);
+    if (iter == _MeshCache.end())
+    {
+        PROFILE_SCOPE("Render: mesh config");
+
+        if (static_cast<int>(_MeshCache.size()) >= cMeshCacheSize)
+        {
+            auto lruIter = std::min_element(_MeshCache.begin(), _MeshCache.end(),
+                                            [](auto &lhs, auto &rhs) { return lhs.second._LastUse < rhs.second._LastUse; });
+            _MeshCache.erase(lruIter);
+        }
+
+        _MeshVertices.clear();
+        BuildGreedyMesh(config, _MeshVertices);
+
+        iter = _MeshCache.emplace(configID, CachedMesh()).first;
+        auto &cachedMesh = iter->second;
+        cachedMesh._Mesh = std::make_unique<VertexBuffer>();
+        cachedMesh._Mesh->SetData(_MeshVertices.data(), _MeshVertices.size()).SetUsage(0, 3).SetUsage(1, 2).SetUsage(2, 3).EndSetUsage();
+        cachedMesh._VertexNum = _MeshVertices.size() / 8;
+        DLOG_INFO("Meshed config #%d: %u vertices", configID, cachedMesh._VertexNum);
+    }
+
+    iter->second._LastUse = ++_MeshCacheClock;
+    _CurrentMesh = &iter->second;
+}
+
+void PuzzleRenderer::UpdateInstances(PuzzleConfig &config)
+{
+    PROFILE_SCOPE("Render: update instances");
+
+    _InstanceData.clear();
+    config.TraverseOccupiedRuns([&](int pieceID, int x, int z, int length) {
+        auto &color = _Materials[pieceID]._Color;
+        for (int dz = 0; dz < length; dz++)
+        {
+            _InstanceData.insert(_InstanceData.end(), {float(x), 0.0f, float(z + dz), color.x, color.y, color.z});
+        }
+    });
+
+    _InstanceNum = _InstanceData.size() / 6;
+    _VoxelModel.SetInstanceData(_InstanceData.data(), _InstanceData.size());
+}
+
+void PuzzleRenderer::Render(Shader &shader)
+{
+    if (!_CurrentMesh && _InstanceNum == 0)
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("Render: puzzle");
+    shader.Activate();
+    if (_CurrentMesh)
+    {
+        _CurrentMesh->_Mesh->DrawTriangles(0, _CurrentMesh->_VertexNum);
+    }
+    else
+    {
+        _VoxelModel.DrawTrianglesInstanced(0, 36, _InstanceNum);
+    }
+}
+
+void PuzzleRenderer::BuildGreedyMesh(PuzzleConfig &config, std::vector<float> &vertices)
+{
+    // greedy meshing (https://0fps.net/2012/06/30/meshing-in-a-minecraft-game/) of a single layer of voxels:
+    // the top and bottom faces of a piece are covered by maximal rectangles, its sides by maximal runs along the border
+    // all voxels have the same height, so a side is only visible if it faces an empty cell
+    auto [minX, minZ, sizeX, sizeZ] = config.GetPuzzleSize();
+    std::vector<int> cells(sizeX * sizeZ, -1); // cells[x * sizeZ + z]: the piece at (minX + x, minZ + z), -1 if empty
+    config.TraverseOccupiedRuns([&](int pieceID, int x, int z, int length) {
+        std::fill_n(cells.begin() + (x - minX) * sizeZ + (z - minZ), length, pieceID);
+    });
+
+    auto GetPieceID = [&](int x, int z) {
+        return (x < 0 || x >= sizeX || z < 0 || z >= sizeZ) ? -1 : cells[x * sizeZ + z];
+    };
+
+    // vertex: position, texture coordinates in voxels (so that the shader still outlines every voxel), color
+    auto AppendQuad = [&](int pieceID, const float (&corners)[4][5]) {
+        auto &color = _Materials[pieceID]._Color;
+        for (int i : {0, 1, 2, 2, 3, 0})
+        {
+            vertices.insert(vertices.end(), corners[i], corners[i] + 5);
+            vertices.insert(vertices.end(), {color.x, color.y, color.z});
+        }
+    };
+
+    std::vector<std::uint8_t> covered(cells.size());
+    for (int x = 0; x < sizeX; x++)
+    {
+        for (int z = 0; z < sizeZ; z++)
+        {
+            int pieceID = cells[x * sizeZ + z];
+            if (pieceID == -1 || covered[x * sizeZ + z])
+            {
+                continue;
+            }
+
+            // grow along z, then along x as long as the whole span of the next column matches
+            int depth = 1, width = 1;
+            while (GetPieceID(x, z + depth) == pieceID && !covered[x * sizeZ + z + depth])
+            {
+                depth++;
+            }
+            for (bool grow = true; grow && x + width < sizeX; width += grow)
+            {
+                for (int dz = 0; dz < depth && grow; dz++)
+                {
+                    grow = cells[(x + width) * sizeZ + z + dz] == pieceID && !covered[(x + width) * sizeZ + z + dz];
+                }
+            }
+
+            for (int dx = 0; dx < width; dx++)
+            {
+                std::fill_n(covered.begin() + (x + dx) * sizeZ + z, depth, 1);
+            }
+
+            float x0 = minX + x - 0.5f, z0 = minZ + z - 0.5f, x1 = x0 + width, z1 = z0 + depth, u = width, v = depth;
+            for (float y : {0.5f, -0.5f})
+            {
+                AppendQuad(pieceID, {{x0, y, z0, 0, 0}, {x1, y, z0, u, 0}, {x1, y, z1, u, v}, {x0, y, z1, 0, v}});
+            }
+        }
+    }
+
+    // the sides facing -z / +z run along x, the ones facing -x / +x run along z
+    for (int dir : {-1, 1})
+    {
+        for (int z = 0; z < sizeZ; z++)
+        {
+            for (int x = 0, length = 1; x < sizeX; x += length, length = 1)
+            {
+                int pieceID = GetPieceID(x, z);
+                if (pieceID == -1 || GetPieceID(x, z + dir) != -1)
+                {
+                    continue;
+                }
+
+                while (GetPieceID(x + length, z) == pieceID && GetPieceID(x + length, z + dir) == -1)
+                {
+                    length++;
+                }
+
+                float x0 = minX + x - 0.5f, x1 = x0 + length, zSide = minZ + z + dir * 0.5f, u = length;
+                AppendQuad(pieceID, {{x0, -0.5f, zSide, 0, 0}, {x1, -0.5f, zSide, u, 0}, {x1, 0.5f, zSide, u, 1}, {x0, 0.5f, zSide, 0, 1}});
+            }
+        }
+
+        for (int x = 0; x < sizeX; x++)
+        {
+            for (int z = 0, length = 1; z < sizeZ; z += length, length = 1)
+            {
+                int pieceID = GetPieceID(x, z);
+                if (pieceID == -1 || GetPieceID(x + dir, z) != -1)
+                {
+                    continue;
+                }
+
+                while (GetPieceID(x, z + length) == pieceID && GetPieceID(x + dir, z + length) == -1)
+                {
+                    length++;
+                }
+
+                float xSide = minX + x + dir * 0.5f, z0 = minZ + z - 0.5f, z1 = z0 + length, u = length;
+                AppendQuad(pieceID, {{xSide, -0.5f, z0, 0, 0}, {xSide, -0.5f, z1, u, 0}, {xSide, 0.5f, z1, u, 1}, {xSide, 0.5f, z0, 0, 1}});
+            }
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "VertexBuffer.h"
+
+#include "PuzzleConfig.h"
+
+struct PuzzlePieceMaterial
+{
+    PuzzlePieceMaterial() = default;
+    explicit PuzzlePieceMaterial(glm::vec3 &&color) noexcept : _Color(color)
+    {
+    }
+
+    glm::vec3 _Color;
+};
+
+// everything about drawing configs lives here, so that the solver (PuzzleConfig, DisassemblyGraph) can be built without OpenGL
+class PuzzleRenderer
+{
+public:
+    // builds the unit voxel of the instanced path, needs the GL context
+    void Init();
+
+    // should be called once after a puzzle is imported, the cached meshes are dropped
+    void AssignPuzzlePieceMaterials(int pieceNum);
+
+    // greedy meshes by default, otherwise one instanced unit voxel per occupied cell (nothing cached, but 36 vertices per voxel)
+    // takes effect with the next SetConfig
+    void SetGreedyMeshing(bool enabled);
+
+    // selects the config to render, its mesh is only built the first time (per config ID) and then kept on the GPU
+    void SetConfig(int configID, PuzzleConfig &config);
+    void Render(Shader &shader);
+
+private:
+    // the voxels of every piece merged into as few quads as possible, taken from the RLE map of the config
+    // 8 floats per vertex: x, y, z, u, v, r, g, b
+    void BuildGreedyMesh(PuzzleConfig &config, std::vector<float> &vertices);
+    // one instance (position, color) per occupied voxel, taken from the RLE map of the config
+    void UpdateInstances(PuzzleConfig &config);
+
+private:
+    std::vector<PuzzlePieceMaterial> _Materials; // indexed by piece ID
+
+    struct CachedMesh
+    {
+        std::unique_ptr<VertexBuffer> _Mesh;
+        unsigned _VertexNum = 0;
+        std::uint64_t _LastUse = 0;
+    };
+
+    std::unordered_map<int, CachedMesh> _MeshCache; // by config ID, LRU of cMeshCacheSize meshes
+    std::uint64_t _MeshCacheClock = 0;
+    CachedMesh *_CurrentMesh = nullptr;
+    std::vector<float> _MeshVertices; // reused
+
+    bool _GreedyMeshing = true;
+    VertexBuffer _VoxelModel;         // the instanced path: a unit voxel + an instance per occupied voxel
+    std::vector<float> _InstanceData; // reused, x, y, z, r, g, b per voxel
+    unsigned _InstanceNum = 0;
+};
@@ -0,0 +1,499 @@
+#include "SolutionCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <type_traits>
+
+#include "Logger.h"
+#include "Profiler.h"
+#include "Utils.h"
+
+#include "HLP_Config.h"
+
+// file layout (native endianness, like the binary puzzle files):
+// SolutionFileHeader, then the record of the graph, a record is
+//   difficulty, node num, per node: parent, move, key; edge num, edges; plan size, plan
+//   subassembly plan num, per subassembly plan: plan offset, piece mask, built flag, the record of its graph if built
+namespace {
+    struct SolutionFileHeader
+    {
+        std::int32_t _MagicNumber;
+        std::int32_t _SolverVersion;
+        std::uint64_t _PuzzleHash;
+        std::uint64_t _Checksum; // of everything after the header
+        std::uint8_t _Complete;
+        std::uint8_t _HasGraph;
+        std::uint8_t _PieceMaskWordNum; // the piece masks are stored as they are, so their size depends on cMaxPieceNum
+        std::uint8_t _Padding[5];
+    };
+    static_assert(sizeof(SolutionFileHeader) == 32);
+
+    struct SolutionFileNode
+    {
+        std::int32_t _Parent;
+        std::int16_t _Distance;
+        std::int8_t _Direction;
+        std::uint8_t _Removal;
+        PieceMask _SubasmMask;
+        std::uint64_t _Key;
+    };
+    static_assert(sizeof(SolutionFileNode) == 16 + sizeof(PieceMask));
+
+    struct SolutionFileEdge
+    {
+        std::int32_t _U, _V;
+    };
+
+    std::uint64_t CalculateChecksum(const std::byte *data, std::size_t size)
+    {
+        std::uint64_t checksum = Mix64(size);
+        for (std::size_t offset = 0; offset < size; offset += sizeof(std::uint64_t))
+        {
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + offset, std::min(sizeof(word), size - offset));
+            checksum = Mix64(checksum ^ word);
+        }
+
+        return checksum;
+    }
+
+    // the graph as it's stored, everything is validated before any of it goes into a graph
+    struct SolutionRecord
+    {
+        struct SubassemblyRecord
+        {
+            int _PlanOffset = 0;
+            PieceMask _PieceMask;
+            std::unique_ptr<SolutionRecord> _Record; // nullptr if the subassembly cannot be disassembled
+        };
+
+        int _Difficulty = 0;
+        std::vector<SolutionFileNode> _Nodes;
+        std::vector<SolutionFileEdge> _Edges;
+        std::vector<int> _Plan;
+        std::vector<SubassemblyRecord> _Subassemblies;
+    };
+
+    class SolutionWriter
+    {
+    public:
+        template <typename T>
+        void Write(const T &value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            auto bytes = reinterpret_cast<const std::byte *>(&value);
+            _Buffer.insert(_Buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        template <typename T>
+        void WriteArray(const std::vector<T> &values)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Write(static_cast<std::uint32_t>(values.size()));
+            auto bytes = reinterpret_cast<const std::byte *>(values.data()); // may be null if empty, inserts nothing then
+            _Buffer.insert(_Buffer.end(), bytes, bytes + values.size() * sizeof(T));
+        }
+
+        std::vector<std::byte> &GetBuffer()
+        {
+            return _Buffer;
+        }
+
+    private:
+        std::vector<std::byte> _Buffer;
+    };
+
+    // every read is checked against the end of the file
+    class SolutionReader
+    {
+    public:
+        SolutionReader(const std::byte *data, std::size_t size) : _Data(data), _Size(size)
+        {
+        }
+
+        template <typename T>
+        bool Read(T &value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (_Size - _Offset < sizeof(T))
+            {
+                return false;
+            }
+
+            std::memcpy(&value, _Data + _Offset, sizeof(T));
+            _Offset += sizeof(T);
+            return true;
+        }
+
+        template <typename T>
+        bool ReadArray(std::vector<T> &values)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            std::uint32_t num = 0;
+            if (!Read(num) || (_Size - _Offset) / sizeof(T) < num)
+            {
+                return false;
+            }
+
+            values.resize(num);
+            if (num > 0)
+            {
+                std::memcpy(values.data(), _Data + _Offset, num * sizeof(T));
+            }
+            _Offset += num * sizeof(T);
+            return true;
+        }
+
+        bool IsAtEnd() const
+        {
+            return _Offset == _Size;
+        }
+
+    private:
+        const std::byte *_Data;
+        std::size_t _Size;
+        std::size_t _Offset = 0;
+    };
+} // namespace
+
+// the parts touching the internals of DisassemblyGraph (it's a friend)
+struct SolutionCacheAccess
+{
+    static std::unique_ptr<SolutionRecord> MakeRecord(const DisassemblyGraph &graph, bool withGraph)
+    {
+        auto record = std::make_unique<SolutionRecord>();
+        record->_Difficulty = graph._MinTargetNodeDepth;
+
+        auto addNode = [&](int configID, int parent) {
+            auto &move = graph._GraphNodesMoves[configID];
+            record->_Nodes.push_back(
+                {parent, move._Distance, move._Direction, move._Removal, move._SubasmMask, graph._GraphNodesKeys[configID]});
+        };
+
+        if (withGraph)
+        {
+            for (int configID = 0; configID < graph.GetPuzzleConfigNum(); configID++)
+            {
+                addNode(configID, graph._GraphNodesParents[configID]);
+            }
+            for (auto [u, v] : graph._GraphEdges)
+            {
+                record->_Edges.push_back({u, v});
+            }
+            record->_Plan = graph._DisassemblyPlan;
+        }
+        else
+        {
+            // the plan is a chain from the root: node k is the k-th config of the plan
+            for (int k = 0; k < graph.GetDisasmPlanSize(); k++)
+            {
+                addNode(graph._DisassemblyPlan[k], k - 1);
+                record->_Plan.push_back(k);
+                if (k > 0)
+                {
+                    record->_Edges.push_back({k - 1, k});
+                }
+            }
+        }
+
+        for (auto &subassemblyPlan : graph._SubassemblyPlans)
+        {
+            auto &subassembly = record->_Subassemblies.emplace_back();
+            subassembly._PlanOffset = subassemblyPlan._PlanOffset;
+            subassembly._PieceMask = subassemblyPlan._PieceMask;
+            if (subassemblyPlan._Graph->IsDisasmGraphBuilt())
+            {
+                subassembly._Record = MakeRecord(*subassemblyPlan._Graph, withGraph);
+            }
+        }
+
+        return record;
+    }
+
+    static void ApplyRecord(DisassemblyGraph &graph, SolutionRecord &record)
+    {
+        std::lock_guard graphLock(graph._GraphMutex);
+        int nodeNum = record._Nodes.size();
+        graph._GraphNodesParents.resize(nodeNum);
+        graph._GraphNodesMoves.resize(nodeNum);
+        graph._GraphNodesKeys.resize(nodeNum);
+        for (int configID = 0; configID < nodeNum; configID++)
+        {
+            auto &node = record._Nodes[configID];
+            graph._GraphNodesParents[configID] = node._Parent;
+            graph._GraphNodesMoves[configID] = {node._SubasmMask, node._Distance, node._Direction, node._Removal != 0};
+            graph._GraphNodesKeys[configID] = node._Key;
+        }
+
+        // the parents come first, so the configs are replayed in ID order
+        if (!graph._CompactStorage)
+        {
+            graph._GraphNodes.reserve(nodeNum);
+            for (int configID = 1; configID < nodeNum; configID++)
+            {
+                auto &parent = graph._GraphNodes[graph._GraphNodesParents[configID]];
+                auto config = parent.MakeNeighborConfig(graph._GraphNodesMoves[configID], graph._StateArena);
+                graph._GraphNodes.push_back(std::move(config));
+            }
+        }
+
+        graph._GraphEdges.reserve(record._Edges.size());
+        for (auto &edge : record._Edges)
+        {
+            graph._GraphEdges.emplace_back(edge._U, edge._V);
+        }
+        graph._RebuildGraphNodesIndex(std::bit_ceil(std::max<std::size_t>(64, std::size_t(nodeNum) * 2)));
+        graph._DisassemblyPlan = std::move(record._Plan);
+        graph._MinTargetNodeDepth = record._Difficulty;
+        graph._PrevTargetNodeID = graph._DisassemblyPlan.back();
+        graph._DisasmGraphBuilt = true;
+
+        for (auto &subassembly : record._Subassemblies)
+        {
+            auto pieces = graph._MakeSubassemblyPieces(graph._DisassemblyPlan[subassembly._PlanOffset]);
+
+            auto &subassemblyPlan = graph._SubassemblyPlans.emplace_back();
+            subassemblyPlan._PlanOffset = subassembly._PlanOffset;
+            subassemblyPlan._PieceMask = subassembly._PieceMask;
+            subassemblyPlan._Graph = std::make_unique<DisassemblyGraph>();
+            subassemblyPlan._Graph->SetCompactStorage(graph._CompactStorage);
+            subassemblyPlan._Graph->_ParentGraph = &graph;
+            if (subassemblyPlan._Graph->ImportPuzzle(std::move(pieces)) && subassembly._Record)
+            {
+                ApplyRecord(*subassemblyPlan._Graph, *subassembly._Record);
+            }
+        }
+
+        graph._ReportProgress(0, 0, 0);
+    }
+};
+
+namespace {
+    void WriteRecord(SolutionWriter &writer, const SolutionRecord &record)
+    {
+        writer.Write(static_cast<std::int32_t>(record._Difficulty));
+        writer.WriteArray(record._Nodes);
+        writer.WriteArray(record._Edges);
+        writer.WriteArray(record._Plan);
+
+        writer.Write(static_cast<std::uint32_t>(record._Subassemblies.size()));
+        for (auto &subassembly : record._Subassemblies)
+        {
+            writer.Write(static_cast<std::int32_t>(subassembly._PlanOffset));
+            writer.Write(subassembly._PieceMask);
+            writer.Write(static_cast<std::uint8_t>(subassembly._Record != nullptr));
+            if (subassembly._Record)
+            {
+                WriteRecord(writer, *subassembly._Record);
+            }
+        }
+    }
+
+    bool ReadRecord(SolutionReader &reader, int pieceNum, SolutionRecord &record)
+    {
+        std::int32_t difficulty = 0;
+        if (!reader.Read(difficulty) || !reader.ReadArray(record._Nodes) || !reader.ReadArray(record._Edges) ||
+            !reader.ReadArray(record._Plan))
+        {
+            return false;
+        }
+        record._Difficulty = difficulty;
+
+        // a tree rooted at node #0 whose moves only touch the pieces of the puzzle
+        int nodeNum = record._Nodes.size();
+        PieceMask allPieceMask = PieceMask::FromRange(pieceNum);
+        if (nodeNum == 0 || record._Nodes[0]._Parent != -1 || record._Nodes[0]._SubasmMask)
+        {
+            return false;
+        }
+        for (int configID = 1; configID < nodeNum; configID++)
+        {
+            auto &node = record._Nodes[configID];
+            if (node._Parent < 0 || node._Parent >= configID || !node._SubasmMask || (node._SubasmMask & ~allPieceMask) ||
+                node._Direction < 0 || node._Direction >= 4)
+            {
+                return false;
+            }
+        }
+
+        for (auto &edge : record._Edges)
+        {
+            if (edge._U < 0 || edge._U >= edge._V || edge._V >= nodeNum)
+            {
+                return false;
+            }
+        }
+
+        if (record._Plan.empty() || record._Plan[0] != 0)
+        {
+            return false;
+        }
+        for (int configID : record._Plan)
+        {
+            if (configID < 0 || configID >= nodeNum)
+            {
+                return false;
+            }
+        }
+
+        std::uint32_t subassemblyNum = 0;
+        if (!reader.Read(subassemblyNum))
+        {
+            return false;
+        }
+
+        for (std::uint32_t i = 0; i < subassemblyNum; i++)
+        {
+            std::int32_t planOffset = 0;
+            PieceMask pieceMask;
+            std::uint8_t built = 0;
+            if (!reader.Read(planOffset) || !reader.Read(pieceMask) || !reader.Read(built))
+            {
+                return false;
+            }
+
+            // the subassembly must be the one removed at that step of the plan
+            if (planOffset <= 0 || planOffset >= int(record._Plan.size()))
+            {
+                return false;
+            }
+            auto &node = record._Nodes[record._Plan[planOffset]];
+            if (!node._Removal || node._SubasmMask != pieceMask || pieceMask.GetPieceNum() <= 1)
+            {
+                return false;
+            }
+
+            auto &subassembly = record._Subassemblies.emplace_back();
+            subassembly._PlanOffset = planOffset;
+            subassembly._PieceMask = pieceMask;
+            if (built)
+            {
+                subassembly._Record = std::make_unique<SolutionRecord>();
+                if (!ReadRecord(reader, pieceMask.GetPieceNum(), *subassembly._Record))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+} // namespace
+
+void SolutionCache::Init(const std::string &folderPath, bool storeGraph)
+{
+    _FolderPath = folderPath;
+    _StoreGraph = storeGraph;
+}
+
+bool SolutionCache::Load(DisassemblyGraph &graph, bool complete)
+{
+    if (_FolderPath.empty() || graph.GetPuzzleConfigNum() != 1 || graph.IsDisasmGraphBuilt())
+    {
+        return false;
+    }
+
+    PROFILE_SCOPE("Cache: load");
+
+    MappedFile solutionFile;
+    if (!solutionFile.Open(_GetEntryPath(graph.GetPuzzleHash(), complete)))
+    {
+        return false;
+    }
+
+    SolutionReader reader(solutionFile.GetData(), solutionFile.GetSize());
+    SolutionFileHeader header;
+    if (!reader.Read(header) || header._MagicNumber != cSolutionFileMagicNumber || header._PuzzleHash != graph.GetPuzzleHash() ||
+        header._Complete != complete)
+    {
+        LOG_WARNING("Ignored the invalid solution cache entry of puzzle %016llx", (unsigned long long)graph.GetPuzzleHash());
+        return false;
+    }
+
+    if (header._SolverVersion != cSolverVersion || header._PieceMaskWordNum != PieceMask::cWordNum)
+    {
+        DLOG_INFO("The solution cache entry of puzzle %016llx is outdated", (unsigned long long)graph.GetPuzzleHash());
+        return false;
+    }
+
+    SolutionRecord record;
+    if (header._Checksum != CalculateChecksum(solutionFile.GetData() + sizeof(header), solutionFile.GetSize() - sizeof(header)) ||
+        !ReadRecord(reader, graph.GetPuzzleConfig(0)._GetTotalPieceNum(), record) || !reader.IsAtEnd())
+    {
+        LOG_WARNING("Ignored the corrupted solution cache entry of puzzle %016llx", (unsigned long long)graph.GetPuzzleHash());
+        return false;
+    }
+
+    SolutionCacheAccess::ApplyRecord(graph, record);
+
+    LOG_INFO("Loaded the %s disassembly plan from the solution cache. Plan size = %d", complete ? "complete" : "kernel",
+             graph.GetDisasmPlanSize());
+    return true;
+}
+
+bool SolutionCache::Store(const DisassemblyGraph &graph, bool complete)
+{
+    if (_FolderPath.empty() || !graph.IsDisasmGraphBuilt())
+    {
+        return false;
+    }
+
+    PROFILE_SCOPE("Cache: store");
+
+    SolutionWriter writer;
+    SolutionFileHeader header{};
+    header._MagicNumber = cSolutionFileMagicNumber;
+    header._SolverVersion = cSolverVersion;
+    header._PuzzleHash = graph.GetPuzzleHash();
+    header._Complete = complete;
+    header._HasGraph = _StoreGraph;
+    header._PieceMaskWordNum = PieceMask::cWordNum;
+    writer.Write(header);
+    WriteRecord(writer, *SolutionCacheAccess::MakeRecord(graph, _StoreGraph));
+
+    auto &buffer = writer.GetBuffer();
+    header._Checksum = CalculateChecksum(buffer.data() + sizeof(header), buffer.size() - sizeof(header));
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    std::error_code error;
+    fs::create_directories(_FolderPath, error);
+
+    // written aside and renamed, so a reader never sees a partial entry (not even from another thread storing the same puzzle)
+    static std::atomic<int> tempFileNum = 0;
+    std::string entryPath = _GetEntryPath(graph.GetPuzzleHash(), complete);
+    std::string tempPath = entryPath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "." +
+                           std::to_string(tempFileNum++) + ".tmp";
+
+    {
+        std::ofstream fout(tempPath, std::ios::binary);
+        if (!fout.write(reinterpret_cast<const char *>(buffer.data()), buffer.size()))
+        {
+            LOG_ERROR("Unable to write the solution cache entry %s!", tempPath.c_str());
+            fout.close();
+            fs::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    fs::rename(tempPath, entryPath, error);
+    if (error)
+    {
+        LOG_ERROR("Unable to write the solution cache entry %s!", entryPath.c_str());
+        fs::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+std::string SolutionCache::_GetEntryPath(std::uint64_t puzzleHash, bool complete) const
+{
+    char fileName[64];
+    std::snprintf(fileName, sizeof(fileName), "%016llx_%s.hlps", (unsigned long long)puzzleHash, complete ? "complete" : "kernel");
+    return (fs::path(_FolderPath) / fileName).string();
+}
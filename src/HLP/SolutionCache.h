@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "DisassemblyGraph.h"
+
+// solved puzzles on disk: one file per (puzzle, kernel / complete), keyed by the content hash of the geometry
+// an entry stores the difficulty and the plan (with the plans of the removed subassemblies), and optionally the compact graph
+// without the graph, only the configs along the plan are restored (so their IDs differ from a real build)
+// entries written by another solver version are ignored (and overwritten by the next Store)
+class SolutionCache
+{
+public:
+    void Init(const std::string &folderPath, bool storeGraph = true);
+
+    // the graph must be freshly imported, on success it's built as if the search had been run
+    bool Load(DisassemblyGraph &graph, bool complete);
+    bool Store(const DisassemblyGraph &graph, bool complete);
+
+private:
+    std::string _GetEntryPath(std::uint64_t puzzleHash, bool complete) const;
+
+private:
+    std::string _FolderPath;
+    bool _StoreGraph = true;
+};
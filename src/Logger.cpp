@@ -2,58 +2,167 @@
 
 #include <chrono>
 #include <cstdarg>
-#include <cstdio>
 #include <ctime>
-#include <iomanip>
-#include <iostream>
+#include <string>
 
 Logger gLogger;
 
-Logger::Logger()
+namespace {
+    constexpr auto cIdleSleepTime = std::chrono::milliseconds(1); // how long the logger thread sleeps when there is nothing to write
+    constexpr std::size_t cMaxLineLength = 512;
+
+    static_assert((cLogRingSize & (cLogRingSize - 1)) == 0, "the ring size must be a power of 2");
+} // namespace
+
+Logger::~Logger()
+{
+    if (_Worker.joinable())
+    {
+        _Stop = true;
+        _Worker.join();
+    }
+
+    // from now on Log writes on the calling thread
+    _Stopped = true;
+    WriteQueuedRecords(); // the records queued while the thread was stopping
+}
+
+Logger::LogRecord *Logger::BeginRecord(std::size_t &pos)
 {
-    _logBuf.fill('0');
+    std::call_once(_StartFlag, [this]() { Start(); });
+
+    pos = _EnqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto &slot = _Ring[pos & (cLogRingSize - 1)];
+        std::size_t sequence = slot._Sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0)
+        {
+            if (_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                return &slot._Record;
+            }
+        }
+        else if (diff < 0) // the slot still holds a record of the previous round, i.e. the ring is full
+        {
+            std::this_thread::yield();
+            pos = _EnqueuePos.load(std::memory_order_relaxed);
+        }
+        else // another producer took it
+        {
+            pos = _EnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
 }
 
-void Logger::Log(LogLevel level, const char *position, const char *fmt, ...)
+void Logger::EndRecord(std::size_t pos)
 {
-    static char buffer[512];
-    _logBuf.str("");
+    _Ring[pos & (cLogRingSize - 1)]._Sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::Start()
+{
+    for (std::size_t i = 0; i < cLogRingSize; i++)
+    {
+        _Ring[i]._Sequence.store(i, std::memory_order_relaxed);
+    }
+
+    _Worker = std::thread([this]() {
+        while (!_Stop.load(std::memory_order_acquire))
+        {
+            if (!WriteQueuedRecords())
+            {
+                std::this_thread::sleep_for(cIdleSleepTime);
+            }
+        }
+        WriteQueuedRecords();
+    });
+}
+
+bool Logger::WriteQueuedRecords()
+{
+    // everything queued so far in one go
+    std::string text;
+    char line[cMaxLineLength];
+    while (true)
+    {
+        auto &slot = _Ring[_DequeuePos & (cLogRingSize - 1)];
+        if (slot._Sequence.load(std::memory_order_acquire) != _DequeuePos + 1)
+        {
+            break;
+        }
+
+        FormatLine(slot._Record, line, sizeof(line));
+        text += line;
+        slot._Sequence.store(_DequeuePos + cLogRingSize, std::memory_order_release);
+        _DequeuePos++;
+    }
 
-    switch (level)
+    if (text.empty())
+    {
+        return false;
+    }
+
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fflush(stdout);
+    return true;
+}
+
+int Logger::FormatArgs(char *buffer, std::size_t size, const char *fmt, ...)
+{
+    std::va_list args;
+    va_start(args, fmt);
+    int length = std::vsnprintf(buffer, size, fmt, args);
+    va_end(args);
+
+    return length;
+}
+
+void Logger::FormatLine(const LogRecord &record, char *line, std::size_t size)
+{
+    const char *levelName = "";
+    switch (record._Level)
     {
     case LogLevel::INFO:
-        _logBuf << "[INFO / ";
+        levelName = "INFO";
         break;
     case LogLevel::WARNING:
-        _logBuf << "[WARNING / ";
+        levelName = "WARNING";
         break;
     case LogLevel::ERROR:
-        _logBuf << "[ERROR / ";
+        levelName = "ERROR";
         break;
     default:
         break;
     }
 
-    PrintTime();
-
-    _logBuf << "] <" << position << "> ";
-
-    std::va_list args;
-    va_start(args, fmt);
-    std::vsprintf(buffer, fmt, args);
-    va_end(args);
-
-    _logBuf << buffer << '\n';
+    // only this thread (or WriteSync, under its lock) formats, std::localtime is fine here
+    auto tt = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    auto pTime = std::localtime(&tt);
 
-    std::string logMsg = _logBuf.str();
-    std::cout << logMsg << std::flush;
+    int length = std::snprintf(line, size, "[%s / %02d:%02d:%02d] <%s> ", levelName, pTime->tm_hour, pTime->tm_min, pTime->tm_sec,
+                               record._Position);
+    length = std::clamp<int>(length, 0, size - 1);
+    int messageLength = record._FormatFunc(line + length, size - length, record._Format, record._Args);
+    length = std::clamp<int>(length + std::max(messageLength, 0), 0, size - 2); // a truncated message still ends the line
+    line[length] = '\n';
+    line[length + 1] = '\0';
 }
 
-void Logger::PrintTime()
+void Logger::WriteSync(LogLevel level, const char *position, const char *fmt, FormatFunc formatFunc, const std::byte *args)
 {
-    auto now = std::chrono::system_clock::now();
-    auto tt = std::chrono::system_clock::to_time_t(now);
-    auto pTime = std::localtime(&tt);
+    std::lock_guard lock(_SyncMutex);
+
+    LogRecord record;
+    record._Level = level;
+    record._Position = position;
+    record._Format = fmt;
+    record._FormatFunc = formatFunc;
+    std::memcpy(record._Args, args, cLogArgsSize);
 
-    _logBuf << std::setw(2) << pTime->tm_hour << ':' << std::setw(2) << pTime->tm_min << ':' << std::setw(2) << pTime->tm_sec;
+    char line[cMaxLineLength];
+    FormatLine(record, line, sizeof(line));
+    std::fputs(line, stdout);
+    std::fflush(stdout);
 }
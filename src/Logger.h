@@ -1,6 +1,16 @@
 #pragma once
 
-#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include "Config.h"
 
 enum class LogLevel
 {
@@ -9,26 +19,156 @@ enum class LogLevel
     ERROR
 };
 
+// asynchronous: Log only copies the arguments into a record of a lock-free ring buffer (MPSC, any thread may log)
+// a background thread formats the records and writes them to stdout, in the order they were queued
+// the format and position must be string literals (they are kept as pointers), string arguments are copied
+// the time is taken when the record is written (within milliseconds), reading the clock would be the dearest part of Log
+// no record is lost: if the ring is full, Log waits for the logger thread to catch up
 class Logger
 {
 public:
-    Logger();
+    ~Logger(); // writes the records still queued
+
+    template <typename... Args>
+    void Log(LogLevel level, const char *position, const char *fmt, const Args &...args);
 
-    void Log(LogLevel level, const char *position, const char *fmt, ...);
+    // never defined: the LOG_* macros only use it in sizeof, so that the compiler checks the format like printf's
+    // (-Wformat) without evaluating the arguments twice
+    [[gnu::format(printf, 1, 2)]] static int CheckFormat(const char *fmt, ...);
 
 private:
-    void PrintTime();
+    // the arguments as they are passed to snprintf: strings are read from the record, everything else by value
+    template <typename T>
+    static constexpr bool cIsString = std::is_same_v<std::decay_t<T>, const char *> || std::is_same_v<std::decay_t<T>, char *>;
+    template <typename T>
+    using StoredArg = std::conditional_t<cIsString<T>, const char *, std::decay_t<T>>;
+
+    using FormatFunc = int (*)(char *buffer, std::size_t size, const char *fmt, const std::byte *args);
+
+    struct LogRecord
+    {
+        LogLevel _Level;
+        const char *_Position;
+        const char *_Format;
+        FormatFunc _FormatFunc;
+        std::byte _Args[cLogArgsSize]; // values (memcpy'd) and strings (null-terminated) in the order of the arguments
+    };
+
+    // Vyukov's bounded queue: a producer claims a slot by advancing _EnqueuePos, the sequence publishes the record
+    // _Sequence == pos: free for the producer of pos, pos + 1: ready for the consumer
+    struct Slot
+    {
+        std::atomic<std::size_t> _Sequence;
+        LogRecord _Record;
+    };
+
+    template <typename... Args>
+    static int FormatRecord(char *buffer, std::size_t size, const char *fmt, const std::byte *args);
+    static int FormatArgs(char *buffer, std::size_t size, const char *fmt, ...); // vsnprintf
+
+    LogRecord *BeginRecord(std::size_t &pos); // waits if the ring is full
+    void EndRecord(std::size_t pos);
+    void WriteSync(LogLevel level, const char *position, const char *fmt, FormatFunc formatFunc, const std::byte *args);
+
+    void Start();
+    bool WriteQueuedRecords(); // on the logger thread (or once it's gone), false if there was nothing to write
+    void FormatLine(const LogRecord &record, char *line, std::size_t size);
 
 private:
-    std::stringstream _logBuf;
+    Slot _Ring[cLogRingSize];
+    alignas(64) std::atomic<std::size_t> _EnqueuePos = 0;
+    alignas(64) std::size_t _DequeuePos = 0; // the logger thread's only
+
+    std::once_flag _StartFlag;
+    std::thread _Worker;
+    std::atomic<bool> _Stop = false;
+    std::atomic<bool> _Stopped = false; // the logger thread is gone, Log writes on the calling thread (e.g. in static destructors)
+    std::mutex _SyncMutex;
 };
 
 extern Logger gLogger;
 
+template <typename... Args>
+void Logger::Log(LogLevel level, const char *position, const char *fmt, const Args &...args)
+{
+    static_assert(((cIsString<Args> || std::is_trivially_copyable_v<std::decay_t<Args>>)&&...), "only trivially copyable log arguments");
+
+    // the fixed-size arguments always fit, the strings share the rest and are truncated if needed
+    constexpr std::size_t fixedSize = ((cIsString<Args> ? 0 : sizeof(StoredArg<Args>)) + ... + 0);
+    constexpr std::size_t stringNum = ((cIsString<Args> ? 1 : 0) + ... + 0);
+    static_assert(fixedSize + stringNum <= cLogArgsSize, "too many log arguments");
+
+    std::byte argBuffer[cLogArgsSize];
+    std::size_t pos = 0;
+    LogRecord *record = _Stopped.load(std::memory_order_relaxed) ? nullptr : BeginRecord(pos);
+    std::byte *out = record ? record->_Args : argBuffer;
+
+    std::size_t stringBudget = cLogArgsSize - fixedSize, stringsLeft = stringNum;
+    [[maybe_unused]] auto Write = [&](const auto &arg) {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (cIsString<T>)
+        {
+            const char *str = arg;
+            str = str ? str : "(null)";
+            std::size_t length = std::min(std::strlen(str), stringBudget - stringsLeft); // one null byte per string is reserved
+            std::memcpy(out, str, length);
+            out[length] = std::byte(0);
+            out += length + 1;
+            stringBudget -= length + 1;
+            stringsLeft--;
+        }
+        else
+        {
+            std::memcpy(out, &arg, sizeof(T));
+            out += sizeof(T);
+        }
+    };
+    (Write(args), ...);
+
+    if (record)
+    {
+        record->_Level = level;
+        record->_Position = position;
+        record->_Format = fmt;
+        record->_FormatFunc = &FormatRecord<StoredArg<Args>...>;
+        EndRecord(pos);
+    }
+    else
+    {
+        WriteSync(level, position, fmt, &FormatRecord<StoredArg<Args>...>, argBuffer);
+    }
+}
+
+template <typename... Args>
+int Logger::FormatRecord(char *buffer, std::size_t size, const char *fmt, const std::byte *args)
+{
+    [[maybe_unused]] auto Read = [&]<typename T>(T *) -> T {
+        if constexpr (std::is_same_v<T, const char *>)
+        {
+            auto str = reinterpret_cast<const char *>(args);
+            args += std::strlen(str) + 1;
+            return str;
+        }
+        else
+        {
+            T value;
+            std::memcpy(&value, args, sizeof(T));
+            args += sizeof(T);
+            return value;
+        }
+    };
+
+    // braced initialization reads the arguments from left to right
+    std::tuple<Args...> values{Read(static_cast<Args *>(nullptr))...};
+    return std::apply([&](const auto &...values) { return FormatArgs(buffer, size, fmt, values...); }, values);
+}
+
+#define LOG_CHECKED(level, ...) (static_cast<void>(sizeof(Logger::CheckFormat(__VA_ARGS__))), gLogger.Log(level, __FUNCTION__, __VA_ARGS__))
+
 #ifdef MY_DEBUG
-#define LOG_INFO(...) gLogger.Log(LogLevel::INFO, __FUNCTION__, __VA_ARGS__)
-#define LOG_WARNING(...) gLogger.Log(LogLevel::WARNING, __FUNCTION__, __VA_ARGS__)
-#define LOG_ERROR(...) gLogger.Log(LogLevel::ERROR, __FUNCTION__, __VA_ARGS__)
+#define LOG_INFO(...) LOG_CHECKED(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_CHECKED(LogLevel::WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_CHECKED(LogLevel::ERROR, __VA_ARGS__)
 #else
 #define LOG_INFO(...)
 #define LOG_WARNING(...)
@@ -36,9 +176,9 @@ extern Logger gLogger;
 #endif
 
 #ifdef DETAILED_DEBUG_INFO
-#define DLOG_INFO(...) gLogger.Log(LogLevel::INFO, __FUNCTION__, __VA_ARGS__)
-#define DLOG_WARNING(...) gLogger.Log(LogLevel::WARNING, __FUNCTION__, __VA_ARGS__)
-#define DLOG_ERROR(...) gLogger.Log(LogLevel::ERROR, __FUNCTION__, __VA_ARGS__)
+#define DLOG_INFO(...) LOG_CHECKED(LogLevel::INFO, __VA_ARGS__)
+#define DLOG_WARNING(...) LOG_CHECKED(LogLevel::WARNING, __VA_ARGS__)
+#define DLOG_ERROR(...) LOG_CHECKED(LogLevel::ERROR, __VA_ARGS__)
 #else
 #define DLOG_INFO(...)
 #define DLOG_WARNING(...)
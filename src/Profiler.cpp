@@ -0,0 +1,110 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "Logger.h"
+
+Profiler gProfiler;
+
+int Profiler::RegisterScope(const char *name)
+{
+    std::lock_guard lock(_RegisterMutex);
+
+    int scopeNum = _ScopeNum.load(std::memory_order_relaxed);
+    for (int i = 0; i < scopeNum; i++)
+    {
+        if (_Scopes[i]._Name == name)
+        {
+            return i;
+        }
+    }
+
+    if (scopeNum == cProfileScopeMaxNum)
+    {
+        LOG_WARNING("Too many profile scopes, %s is not recorded", name);
+        return -1;
+    }
+
+    // the name is written before the scope is published, readers only look at the first _ScopeNum scopes
+    _Scopes[scopeNum]._Name = name;
+    _ScopeNum.store(scopeNum + 1, std::memory_order_release);
+    return scopeNum;
+}
+
+void Profiler::Record(int scopeID, float ms)
+{
+    if (scopeID < 0)
+    {
+        return;
+    }
+
+    auto &scope = _Scopes[scopeID];
+    std::lock_guard lock(scope._Mutex);
+    scope._Samples[scope._Count % cProfileSampleNum] = ms;
+    scope._Count++;
+    scope._Total += ms;
+}
+
+std::vector<ProfileStats> Profiler::GetStats() const
+{
+    std::vector<ProfileStats> statsVec;
+    std::vector<float> sorted;
+
+    int scopeNum = _ScopeNum.load(std::memory_order_acquire);
+    for (int i = 0; i < scopeNum; i++)
+    {
+        auto &scope = _Scopes[i];
+        ProfileStats stats;
+        {
+            std::lock_guard lock(scope._Mutex);
+            if (scope._Count == 0)
+            {
+                continue;
+            }
+
+            // unroll the ring, oldest first
+            int sampleNum = std::min<std::uint64_t>(scope._Count, cProfileSampleNum);
+            int oldest = scope._Count > cProfileSampleNum ? scope._Count % cProfileSampleNum : 0;
+            stats._Samples.resize(sampleNum);
+            for (int j = 0; j < sampleNum; j++)
+            {
+                stats._Samples[j] = scope._Samples[(oldest + j) % cProfileSampleNum];
+            }
+            stats._Count = scope._Count;
+            stats._Total = scope._Total;
+        }
+
+        stats._Name = scope._Name;
+        stats._Last = stats._Samples.back();
+        stats._Mean = std::accumulate(stats._Samples.begin(), stats._Samples.end(), 0.0f) / stats._Samples.size();
+
+        // nearest rank
+        sorted = stats._Samples;
+        std::sort(sorted.begin(), sorted.end());
+        auto Percentile = [&](float p) {
+            int rank = std::ceil(p * sorted.size());
+            return sorted[std::clamp<int>(rank - 1, 0, sorted.size() - 1)];
+        };
+        stats._P50 = Percentile(0.50f);
+        stats._P95 = Percentile(0.95f);
+        stats._P99 = Percentile(0.99f);
+        stats._Max = sorted.back();
+
+        statsVec.push_back(std::move(stats));
+    }
+
+    return statsVec;
+}
+
+void Profiler::Reset()
+{
+    int scopeNum = _ScopeNum.load(std::memory_order_acquire);
+    for (int i = 0; i < scopeNum; i++)
+    {
+        std::lock_guard lock(_Scopes[i]._Mutex);
+        _Scopes[i]._Count = 0;
+        _Scopes[i]._Total = 0.0;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+
+// rolling timings of the last cProfileSampleNum runs of a scope, in ms
+struct ProfileStats
+{
+    std::string _Name;
+    std::vector<float> _Samples; // oldest first
+    std::uint64_t _Count = 0;    // all runs so far, not only the kept ones
+    double _Total = 0.0;         // ditto
+    float _Last = 0.0f, _Mean = 0.0f, _Max = 0.0f;
+    float _P50 = 0.0f, _P95 = 0.0f, _P99 = 0.0f;
+};
+
+// named timing scopes, e.g. the phases of a frame or of a solver level
+// scopes are recorded on any thread (the solver workers too) and read by the profiler panel
+// no rendering code here, the headless tools record the solver scopes as well
+class Profiler
+{
+public:
+    // the same name always gets the same ID, -1 if there are already cProfileScopeMaxNum scopes
+    // register once and keep the ID (PROFILE_SCOPE does), recording by ID takes no lookup
+    int RegisterScope(const char *name);
+    void Record(int scopeID, float ms);
+
+    // a snapshot of the scopes with at least one sample, in the order they were registered
+    std::vector<ProfileStats> GetStats() const;
+    void Reset(); // drops the samples, the scopes stay registered
+
+private:
+    struct Scope
+    {
+        std::string _Name;
+        mutable std::mutex _Mutex; // guards the samples only
+        std::array<float, cProfileSampleNum> _Samples;
+        std::uint64_t _Count = 0; // _Samples[_Count % cProfileSampleNum] is the next one to be written
+        double _Total = 0.0;
+    };
+
+    // a fixed array, so that a scope never moves while others are registered
+    std::array<Scope, cProfileScopeMaxNum> _Scopes;
+    std::atomic<int> _ScopeNum = 0;
+    std::mutex _RegisterMutex;
+};
+
+extern Profiler gProfiler;
+
+// times the enclosing block
+class ProfileScope
+{
+public:
+    explicit ProfileScope(int scopeID) : _ScopeID(scopeID), _StartTime(std::chrono::steady_clock::now())
+    {
+    }
+    ~ProfileScope()
+    {
+        gProfiler.Record(_ScopeID, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - _StartTime).count());
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    int _ScopeID;
+    std::chrono::steady_clock::time_point _StartTime;
+};
+
+// PROFILE_SCOPE("Solver: expand level"); times the rest of the block, the name must be a literal (it's registered once)
+// it costs two clock reads and an uncontended lock, so keep it out of per-config loops
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name)                                                                                                                \
+    static const int PROFILE_CONCAT(profileScopeID, __LINE__) = gProfiler.RegisterScope(name);                                             \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileScopeID, __LINE__))
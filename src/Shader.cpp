@@ -125,6 +125,26 @@ void Shader::SetUniform(const std::string &name, const glm::vec3 &vec)
     glUniform3fv(GetUniformLoc(name), 1, &vec[0]);
 }
 
+void Shader::SetUniform(UniformHandle<int> handle, int value)
+{
+    glUniform1i(handle._Location, value);
+}
+
+void Shader::SetUniform(UniformHandle<float> handle, float value)
+{
+    glUniform1f(handle._Location, value);
+}
+
+void Shader::SetUniform(UniformHandle<glm::mat4> handle, const glm::mat4 &matrix)
+{
+    glUniformMatrix4fv(handle._Location, 1, GL_FALSE, &matrix[0][0]);
+}
+
+void Shader::SetUniform(UniformHandle<glm::vec3> handle, const glm::vec3 &vec)
+{
+    glUniform3fv(handle._Location, 1, &vec[0]);
+}
+
 int Shader::GetUniformLoc(const std::string &name)
 {
     auto iter = _UniformMap.find(name);
@@ -135,3 +155,37 @@ int Shader::GetUniformLoc(const std::string &name)
     }
     return iter->second;
 }
+
+UniformBuffer::~UniformBuffer()
+{
+    if (_BufferCreated)
+    {
+        glDeleteBuffers(1, &_UBO);
+    }
+}
+
+void UniformBuffer::Init(unsigned binding, std::size_t size)
+{
+    if (!_BufferCreated)
+    {
+        glGenBuffers(1, &_UBO);
+        _BufferCreated = true;
+    }
+
+    _Size = size;
+    glBindBuffer(GL_UNIFORM_BUFFER, _UBO);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, _UBO);
+}
+
+void UniformBuffer::Update(const void *pData, std::size_t size, std::size_t offset)
+{
+    if (!_BufferCreated || offset + size > _Size)
+    {
+        std::cout << "fatal: Too much data for the uniform buffer!" << std::endl;
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, _UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, pData);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <climits>
+#include <cstddef>
 #include <string>
 #include <unordered_map>
 
@@ -15,6 +17,31 @@ struct ShaderInfo
     std::string _ComputeShaderPath;
 };
 
+// a uniform resolved once (e.g. right after the shader is initialized), setting it doesn't look anything up
+template <typename T>
+struct UniformHandle
+{
+    int _Location = -1; // -1: unknown uniform, GL ignores it
+};
+
+// a uniform block shared by all shaders which declare it with layout(std140, binding = <binding>)
+class UniformBuffer
+{
+public:
+    UniformBuffer() = default;
+    UniformBuffer(const UniformBuffer &) = delete; // owns the GL buffer
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+    ~UniformBuffer();
+
+    void Init(unsigned binding, std::size_t size);
+    void Update(const void *pData, std::size_t size, std::size_t offset = 0);
+
+private:
+    unsigned _UBO;
+    bool _BufferCreated = false;
+    std::size_t _Size = 0;
+};
+
 class Shader
 {
 public:
@@ -30,6 +57,14 @@ public:
     void SetUniform(const std::string &name, const glm::mat4 &matrix);
     void SetUniform(const std::string &name, const glm::vec3 &vec);
 
+    // for the render loop: resolve the handles once, then set the uniforms through them
+    template <typename T>
+    UniformHandle<T> GetUniformHandle(const std::string &name);
+    void SetUniform(UniformHandle<int> handle, int value);
+    void SetUniform(UniformHandle<float> handle, float value);
+    void SetUniform(UniformHandle<glm::mat4> handle, const glm::mat4 &matrix);
+    void SetUniform(UniformHandle<glm::vec3> handle, const glm::vec3 &vec);
+
 private:
     int GetUniformLoc(const std::string &name);
 
@@ -37,3 +72,10 @@ private:
     unsigned _ProgramID;
     std::unordered_map<std::string, int> _UniformMap;
 };
+
+template <typename T>
+UniformHandle<T> Shader::GetUniformHandle(const std::string &name)
+{
+    int location = GetUniformLoc(name);
+    return {location == INT_MAX ? -1 : location};
+}
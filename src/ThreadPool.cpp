@@ -0,0 +1,255 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool gThreadPool;
+
+namespace {
+    // which deque of which pool belongs to the current thread
+    thread_local const ThreadPool *tPool = nullptr;
+    thread_local int tQueueIndex = 0;
+} // namespace
+
+ThreadPool::~ThreadPool()
+{
+    Shutdown();
+}
+
+void ThreadPool::Init(int threadNum)
+{
+    // the first ParallelFor / Submit may come from several threads at once (e.g. the solver and the generator of the demo)
+    if (_Initialized.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::lock_guard initLock(_InitMutex);
+    if (_Initialized.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    if (threadNum <= 0)
+    {
+        threadNum = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _Stop = false;
+
+    // the thread calling ParallelFor also works, so one less worker is enough
+    for (int i = 0; i < threadNum; i++)
+    {
+        _Queues.push_back(std::make_unique<TaskQueue>());
+    }
+
+    for (int i = 0; i < threadNum - 1; i++)
+    {
+        _Workers.emplace_back([this, i]() { WorkerLoop(i + 1); });
+    }
+
+    _Initialized.store(true, std::memory_order_release);
+}
+
+void ThreadPool::Shutdown()
+{
+    std::lock_guard initLock(_InitMutex);
+    {
+        std::lock_guard lock(_SleepMutex);
+        _Stop = true;
+    }
+    _SleepCV.notify_all();
+
+    for (auto &worker : _Workers)
+    {
+        worker.join();
+    }
+    _Workers.clear();
+    _Queues.clear();
+    _Initialized = false;
+}
+
+int ThreadPool::GetThreadNum() const
+{
+    return _Workers.size() + 1;
+}
+
+int ThreadPool::GetQueueIndex() const
+{
+    return tPool == this ? tQueueIndex : 0;
+}
+
+void ThreadPool::WorkerLoop(int queueIndex)
+{
+    tPool = this;
+    tQueueIndex = queueIndex;
+
+    while (true)
+    {
+        std::function<void()> task;
+        if (PopTask(task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock lock(_SleepMutex);
+        _SleepCV.wait(lock, [this]() { return _Stop || _QueuedNum.load() > 0; });
+
+        if (_Stop && _QueuedNum.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::PopTask(std::function<void()> &task)
+{
+    int queueIndex = GetQueueIndex(), queueNum = _Queues.size();
+
+    // own deque first, newest task (the one whose data is still in the cache)
+    {
+        auto &queue = *_Queues[queueIndex];
+        std::lock_guard lock(queue._Mutex);
+        if (!queue._Tasks.empty())
+        {
+            task = std::move(queue._Tasks.back());
+            queue._Tasks.pop_back();
+            _QueuedNum.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // then steal the oldest task of another deque (usually the biggest piece of work)
+    for (int i = 1; i < queueNum; i++)
+    {
+        auto &queue = *_Queues[(queueIndex + i) % queueNum];
+        std::lock_guard lock(queue._Mutex);
+        if (!queue._Tasks.empty())
+        {
+            task = std::move(queue._Tasks.front());
+            queue._Tasks.pop_front();
+            _QueuedNum.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    Init();
+
+    {
+        auto &queue = *_Queues[GetQueueIndex()];
+        std::lock_guard lock(queue._Mutex);
+        queue._Tasks.push_back(std::move(task));
+    }
+    _QueuedNum.fetch_add(1);
+
+    // a sleeping worker checks _QueuedNum while holding _SleepMutex, so the wake-up can't be lost
+    {
+        std::lock_guard lock(_SleepMutex);
+    }
+    _SleepCV.notify_one();
+}
+
+bool ThreadPool::RunPendingTask()
+{
+    std::function<void()> task;
+    if (!_Initialized.load(std::memory_order_acquire) || !PopTask(task))
+    {
+        return false;
+    }
+
+    task();
+    return true;
+}
+
+void ThreadPool::ParallelFor(int n, const std::function<void(int)> &func)
+{
+    if (n <= 0)
+    {
+        return;
+    }
+
+    Init();
+
+    // every participant grabs the next index until all indices are taken
+    // the state is shared with the helpers, since a helper may start after this function returns
+    struct ForState
+    {
+        std::atomic<int> _NextIndex = 0;
+        std::atomic<int> _FinishedNum = 0;
+        std::mutex _DoneMutex;
+        std::condition_variable _DoneCV;
+    };
+    auto state = std::make_shared<ForState>();
+
+    auto Work = [state, n, &func]() {
+        int index = 0;
+        while ((index = state->_NextIndex.fetch_add(1)) < n)
+        {
+            func(index);
+
+            if (state->_FinishedNum.fetch_add(1) + 1 == n)
+            {
+                std::lock_guard lock(state->_DoneMutex);
+                state->_DoneCV.notify_all();
+            }
+        }
+    };
+
+    int helperNum = std::min(n, GetThreadNum()) - 1;
+    for (int i = 0; i < helperNum; i++)
+    {
+        Submit(Work);
+    }
+
+    Work();
+
+    std::unique_lock lock(state->_DoneMutex);
+    state->_DoneCV.wait(lock, [&]() { return state->_FinishedNum.load() == n; });
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool) : _Pool(pool)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    Wait();
+}
+
+void TaskGroup::Run(std::function<void()> task)
+{
+    {
+        std::lock_guard lock(_Mutex);
+        _PendingNum++;
+    }
+    _Pool.Submit([this, task = std::move(task)]() {
+        task();
+        // the waiter only sees the count drop under the lock, so the group isn't destroyed before this is done with it
+        std::lock_guard lock(_Mutex);
+        _PendingNum--;
+        _DoneCV.notify_all();
+    });
+}
+
+void TaskGroup::Wait()
+{
+    // help instead of blocking: the tasks of this group may be queued on the deque of this very thread
+    // block only when nothing is queued, i.e. the remaining tasks are running on other threads
+    std::unique_lock lock(_Mutex);
+    while (_PendingNum > 0)
+    {
+        lock.unlock();
+        bool ranTask = _Pool.RunPendingTask();
+        lock.lock();
+        if (!ranTask && _PendingNum > 0)
+        {
+            int pendingNum = _PendingNum;
+            _DoneCV.wait(lock, [&]() { return _PendingNum < pendingNum; });
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    ~ThreadPool();
+
+    // threadNum = 0: one worker per hardware thread
+    // it's called automatically by the first ParallelFor / Submit if you don't call it yourself (thread-safe)
+    void Init(int threadNum = 0);
+    void Shutdown();
+
+    int GetThreadNum() const;
+
+    // execute func(0), func(1), ..., func(n - 1) on the workers, return after all of them are finished
+    // the calling thread takes part in the work, so it's safe to call it inside func
+    void ParallelFor(int n, const std::function<void(int)> &func);
+
+    // work stealing: every worker has its own deque, tasks submitted by a worker go to its deque (the others share one)
+    // a worker runs its own tasks newest first, and steals the oldest task of another deque when it runs dry
+    // use TaskGroup to wait for tasks
+    void Submit(std::function<void()> task);
+    bool RunPendingTask(); // runs one queued task on the calling thread, returns false if there was none
+
+private:
+    struct TaskQueue
+    {
+        std::mutex _Mutex;
+        std::deque<std::function<void()>> _Tasks;
+    };
+
+    void WorkerLoop(int queueIndex);
+    int GetQueueIndex() const;
+    bool PopTask(std::function<void()> &task);
+
+private:
+    std::mutex _InitMutex;
+    std::atomic<bool> _Initialized = false;
+    std::vector<std::thread> _Workers;
+    std::vector<std::unique_ptr<TaskQueue>> _Queues; // [0]: threads which are not workers, [i + 1]: worker i
+    std::atomic<int> _QueuedNum = 0;
+    std::mutex _SleepMutex;
+    std::condition_variable _SleepCV;
+    bool _Stop = false;
+};
+
+extern ThreadPool gThreadPool;
+
+// fork-join on the thread pool: tasks may run more tasks of the same group (recursive fan-out)
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool &pool = gThreadPool);
+    ~TaskGroup(); // waits for the tasks
+
+    void Run(std::function<void()> task);
+    // the waiting thread runs queued tasks (of any group) meanwhile, so it's safe to wait inside a task
+    // once nothing is queued any more, it sleeps until a task of the group is done
+    void Wait();
+
+private:
+    ThreadPool &_Pool;
+    std::mutex _Mutex;
+    std::condition_variable _DoneCV;
+    int _PendingNum = 0; // guarded by _Mutex
+};
@@ -1,59 +1,143 @@
 #include "Timer.h"
 
+#include <utility>
+
 Timer gTimer;
 
 void Timer::Tick(float dt)
 {
-    std::vector<int> removedTaskID;
-    int taskNum = _Tasks.size();
-    for (int i = 0; i < taskNum; i++)
     {
-        auto &task = _Tasks[i];
-        task._Counter += dt;
-        if (task._Counter >= task._Cycle)
+        std::lock_guard lock(_PostMutex);
+        std::swap(_PostedTasks, _RunningPostedTasks);
+    }
+    for (auto &callback : _RunningPostedTasks)
+    {
+        callback();
+    }
+    _RunningPostedTasks.clear();
+
+    _Now += dt;
+
+    // the due tasks are taken out first, so that a task rescheduled (or dispatched) in this tick waits for the next one
+    _FiredEntries.clear();
+    while (!_DueQueue.empty() && _DueQueue.top()._DueTime <= _Now)
+    {
+        _FiredEntries.push_back(_DueQueue.top());
+        _DueQueue.pop();
+    }
+
+    for (auto &entry : _FiredEntries)
+    {
+        // removed meanwhile (maybe by a callback of this tick)
+        if (entry._Generation != _Slots[entry._Index]._Generation)
         {
-            task._Counter = 0;
-            task._Callback();
-            if (task._Type == TimerTaskType::FINITE)
+            continue;
+        }
+
+        // callbacks may dispatch tasks and so move the slots, the callback is moved out while it runs
+        auto callback = std::move(_Slots[entry._Index]._Task._Callback);
+        callback();
+
+        auto &slot = _Slots[entry._Index];
+        if (entry._Generation != slot._Generation) // removed by its own callback
+        {
+            continue;
+        }
+        slot._Task._Callback = std::move(callback);
+
+        if (slot._Task._Type == TimerTaskType::FINITE && --slot._Task._LoopNum <= 0)
+        {
+            auto endCallback = std::move(slot._Task._EndCallback);
+            ReleaseTask(entry._Index);
+            if (endCallback)
             {
-                --task._LoopNum;
-                if (task._LoopNum == 0)
-                {
-                    task._EndCallback();
-                    removedTaskID.push_back(i);
-                }
+                endCallback();
             }
+            continue;
         }
-    }
 
-    for (auto id : removedTaskID)
-    {
-        RemoveTask(id);
+        Schedule(entry._Index, _Now + slot._Task._Cycle);
     }
 }
 
-int Timer::DispatchFiniteTask(float cycle, const std::function<void()> &callback, const std::function<void()> &endCallback, int loopNum)
+TimerHandle Timer::DispatchFiniteTask(float cycle, std::function<void()> callback, std::function<void()> endCallback, int loopNum)
 {
-    auto &task = _Tasks.emplace_back();
+    TimerTask task;
     task._Cycle = cycle;
-    task._Callback = callback;
-    task._EndCallback = endCallback;
+    task._Callback = std::move(callback);
+    task._EndCallback = std::move(endCallback);
     task._Type = TimerTaskType::FINITE;
     task._LoopNum = loopNum;
-    return _Tasks.size() - 1;
+    return AddTask(std::move(task));
 }
 
-int Timer::DispatchLoopTask(float cycle, const std::function<void()> &callback)
+TimerHandle Timer::DispatchLoopTask(float cycle, std::function<void()> callback)
 {
-    auto &task = _Tasks.emplace_back();
+    TimerTask task;
     task._Cycle = cycle;
-    task._Callback = callback;
+    task._Callback = std::move(callback);
     task._Type = TimerTaskType::LOOP;
-    return _Tasks.size() - 1;
+    return AddTask(std::move(task));
+}
+
+TimerHandle Timer::DispatchDelayedTask(float delay, std::function<void()> callback)
+{
+    return DispatchFiniteTask(delay, std::move(callback), nullptr, 1);
+}
+
+bool Timer::RemoveTask(TimerHandle handle)
+{
+    if (!IsTaskAlive(handle))
+    {
+        return false;
+    }
+
+    // its heap entry goes stale and is dropped when it comes up
+    ReleaseTask(handle._Index);
+    return true;
+}
+
+bool Timer::IsTaskAlive(TimerHandle handle) const
+{
+    return handle._Index < _Slots.size() && _Slots[handle._Index]._Generation == handle._Generation;
+}
+
+void Timer::Post(std::function<void()> callback)
+{
+    std::lock_guard lock(_PostMutex);
+    _PostedTasks.push_back(std::move(callback));
+}
+
+TimerHandle Timer::AddTask(TimerTask &&task)
+{
+    std::uint32_t index;
+    if (!_FreeSlots.empty())
+    {
+        index = _FreeSlots.back();
+        _FreeSlots.pop_back();
+    }
+    else
+    {
+        index = _Slots.size();
+        _Slots.emplace_back();
+    }
+
+    auto &slot = _Slots[index];
+    slot._Task = std::move(task);
+    Schedule(index, _Now + slot._Task._Cycle);
+
+    return {index, slot._Generation};
+}
+
+void Timer::Schedule(std::uint32_t index, double dueTime)
+{
+    _DueQueue.push({dueTime, _NextOrder++, index, _Slots[index]._Generation});
 }
 
-void Timer::RemoveTask(int taskID)
+void Timer::ReleaseTask(std::uint32_t index)
 {
-    std::swap(_Tasks[taskID], _Tasks.back());
-    _Tasks.pop_back();
+    auto &slot = _Slots[index];
+    slot._Task = TimerTask();
+    slot._Generation = (slot._Generation == UINT32_MAX) ? 1 : slot._Generation + 1; // 0 is never a task
+    _FreeSlots.push_back(index);
 }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <mutex>
+#include <queue>
 #include <vector>
 
 enum class TimerTaskType
@@ -9,26 +12,78 @@ enum class TimerTaskType
     LOOP
 };
 
+// refers to the same task until it ends or is removed, after that it's recognized as stale by its generation
+// (the slot of the task may be reused by another task, with another generation)
+struct TimerHandle
+{
+    std::uint32_t _Index = 0;
+    std::uint32_t _Generation = 0; // 0: no task
+};
+
 struct TimerTask
 {
     float _Cycle = 0;
-    float _Counter = 0;
     TimerTaskType _Type;
     int _LoopNum = 0;
     std::function<void()> _Callback;
     std::function<void()> _EndCallback;
 };
 
+// tasks are kept in a min-heap by the time they are due, so a tick only touches the tasks which fire (O(log n) each)
+// all tasks run on the thread which calls Tick, Post is the only member which may be called on other threads
 class Timer
 {
 public:
     void Tick(float dt);
-    int DispatchFiniteTask(float cycle, const std::function<void()> &callback, const std::function<void()> &endCallback, int loopNum);
-    int DispatchLoopTask(float cycle, const std::function<void()> &callback);
-    void RemoveTask(int taskID);
+
+    // cycle in seconds, the first call is one cycle from now, tasks due at the same time run in the order they were dispatched
+    TimerHandle DispatchFiniteTask(float cycle, std::function<void()> callback, std::function<void()> endCallback, int loopNum);
+    TimerHandle DispatchLoopTask(float cycle, std::function<void()> callback);
+    // deferred work, runs once after delay seconds (0: at the next tick)
+    TimerHandle DispatchDelayedTask(float delay, std::function<void()> callback);
+    // false if the task has already ended or been removed, the end callback of a removed task isn't called
+    bool RemoveTask(TimerHandle handle);
+    bool IsTaskAlive(TimerHandle handle) const;
+
+    // thread-safe: the callback runs at the beginning of the next tick, e.g. to hand the results of a worker over to the UI
+    void Post(std::function<void()> callback);
 
 private:
-    std::vector<TimerTask> _Tasks;
+    struct TaskSlot
+    {
+        TimerTask _Task;
+        std::uint32_t _Generation = 1; // bumped whenever the task ends, so that its handles (and heap entries) go stale
+    };
+
+    // a heap entry whose generation doesn't match its slot any more belongs to a removed task, it's skipped when popped
+    struct DueEntry
+    {
+        double _DueTime;
+        std::uint64_t _Order; // dispatch order, for ties
+        std::uint32_t _Index;
+        std::uint32_t _Generation;
+
+        bool operator>(const DueEntry &rhs) const
+        {
+            return _DueTime != rhs._DueTime ? _DueTime > rhs._DueTime : _Order > rhs._Order;
+        }
+    };
+
+    TimerHandle AddTask(TimerTask &&task);
+    void Schedule(std::uint32_t index, double dueTime);
+    void ReleaseTask(std::uint32_t index);
+
+private:
+    double _Now = 0.0; // the sum of all dt so far
+    std::uint64_t _NextOrder = 0;
+    std::vector<TaskSlot> _Slots;
+    std::vector<std::uint32_t> _FreeSlots;
+    std::priority_queue<DueEntry, std::vector<DueEntry>, std::greater<DueEntry>> _DueQueue;
+    std::vector<DueEntry> _FiredEntries; // reused by Tick
+
+    std::mutex _PostMutex;
+    std::vector<std::function<void()>> _PostedTasks;
+    std::vector<std::function<void()>> _RunningPostedTasks; // reused by Tick
 };
 
 extern Timer gTimer;
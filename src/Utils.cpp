@@ -4,6 +4,17 @@
 #include <numeric>
 #include <random>
 
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "Logger.h"
 
 void RandPiecewiseDist(std::vector<float> &result, int count, const std::vector<float> &segments, const std::vector<int> &weight)
@@ -22,7 +33,8 @@ void RandPiecewiseDist(std::vector<float> &result, int count, const std::vector<
     for (int i = 0; i < count; i++)
     {
         float x = preWeight[nWeight] * dist(engine);
-        int segNo = std::lower_bound(preWeight.begin(), preWeight.end(), x) - preWeight.begin();
+        // x is in [preWeight[segNo], preWeight[segNo + 1])
+        int segNo = std::upper_bound(preWeight.begin(), preWeight.end(), x) - preWeight.begin() - 1;
         result[i] = dist(engine) * (segments[segNo + 1] - segments[segNo]) + segments[segNo];
     }
 }
@@ -44,6 +56,122 @@ void TraverseFolder(const std::string &folderPath, const std::function<void(cons
     }
 }
 
+MappedFile::MappedFile(MappedFile &&rhs) noexcept
+{
+    *this = std::move(rhs);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        Close();
+        std::swap(_Data, rhs._Data);
+        std::swap(_Size, rhs._Size);
+#ifdef _WIN32
+        std::swap(_FileHandle, rhs._FileHandle);
+        std::swap(_MappingHandle, rhs._MappingHandle);
+#endif
+    }
+
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string &filePath)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data)
+    {
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+
+    _FileHandle = file;
+    _MappingHandle = mapping;
+    _Size = size.QuadPart;
+#else
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    // the mapping keeps the file alive, the descriptor isn't needed any more
+    struct stat fileStat;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    _Size = fileStat.st_size;
+#endif
+
+    _Data = static_cast<const std::byte *>(data);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (!_Data)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(_Data);
+    CloseHandle(_MappingHandle);
+    CloseHandle(_FileHandle);
+    _FileHandle = _MappingHandle = nullptr;
+#else
+    munmap(const_cast<std::byte *>(_Data), _Size);
+#endif
+
+    _Data = nullptr;
+    _Size = 0;
+}
+
+const std::byte *MappedFile::GetData() const
+{
+    return _Data;
+}
+
+std::size_t MappedFile::GetSize() const
+{
+    return _Size;
+}
+
 void DSU::Init(int n)
 {
     size.resize(n);
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <format>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #ifdef DETAILED_DEBUG_INFO
@@ -24,6 +28,85 @@ void RandPiecewiseDist(std::vector<float> &result, int count, const std::vector<
 
 void TraverseFolder(const std::string &folderPath, const std::function<void(const fs::path &)> &callback);
 
+// splitmix64 finalizer, spreads the bits of a packed key over the whole word
+inline std::uint64_t Mix64(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// chunked bump allocator: blocks never move once allocated, and everything is freed at once by Clear()
+// the chunks double in size (starting from firstChunkSize), so at most half of the memory is unused
+// nothing is destructed one by one, so T must be trivially destructible
+template <typename T>
+class Arena
+{
+    static_assert(std::is_trivially_destructible_v<T>, "Arena doesn't call destructors");
+
+public:
+    explicit Arena(std::size_t firstChunkSize = 256) : _FirstChunkSize(firstChunkSize)
+    {
+    }
+
+    // returns n contiguous uninitialized elements
+    T *Allocate(std::size_t n)
+    {
+        if (_ChunkUsed + n > _ChunkCapacity)
+        {
+            _ChunkCapacity = std::max(_Chunks.empty() ? _FirstChunkSize : _ChunkCapacity * 2, n);
+            _ChunkUsed = 0;
+            _Chunks.push_back(std::make_unique_for_overwrite<T[]>(_ChunkCapacity));
+            _TotalCapacity += _ChunkCapacity;
+        }
+
+        T *block = _Chunks.back().get() + _ChunkUsed;
+        _ChunkUsed += n;
+        return block;
+    }
+
+    void Clear()
+    {
+        _Chunks.clear();
+        _ChunkUsed = _ChunkCapacity = _TotalCapacity = 0;
+    }
+
+    std::size_t GetMemoryUsage() const // in bytes
+    {
+        return _TotalCapacity * sizeof(T) + _Chunks.capacity() * sizeof(std::unique_ptr<T[]>);
+    }
+
+private:
+    std::size_t _FirstChunkSize;
+    std::size_t _ChunkUsed = 0, _ChunkCapacity = 0, _TotalCapacity = 0;
+    std::vector<std::unique_ptr<T[]>> _Chunks;
+};
+
+// read-only mapping of a whole file, valid as long as the object lives
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(MappedFile &&rhs) noexcept;
+    MappedFile &operator=(MappedFile &&rhs) noexcept;
+    ~MappedFile();
+
+    bool Open(const std::string &filePath); // fails for empty files (they can't be mapped)
+    void Close();
+
+    const std::byte *GetData() const;
+    std::size_t GetSize() const;
+
+private:
+    const std::byte *_Data = nullptr;
+    std::size_t _Size = 0;
+#ifdef _WIN32
+    void *_FileHandle = nullptr;
+    void *_MappingHandle = nullptr;
+#endif
+};
+
 class DSU // from OI wiki
 {
 public:
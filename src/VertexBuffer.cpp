@@ -4,6 +4,20 @@
 
 #include <glad/glad.h>
 
+VertexBuffer::~VertexBuffer()
+{
+    if (_BufferCreated)
+    {
+        glDeleteVertexArrays(1, &_VAO);
+        glDeleteBuffers(1, &_VBO);
+    }
+
+    if (_InstanceBufferCreated)
+    {
+        glDeleteBuffers(1, &_InstanceVBO);
+    }
+}
+
 VertexBuffer &VertexBuffer::SetData(float *pData, unsigned cntFloats)
 {
     if (!_BufferCreated)
@@ -77,12 +91,82 @@ VertexBuffer &VertexBuffer::EndSetUsage()
     return *this;
 }
 
+VertexBuffer &VertexBuffer::SetInstanceData(float *pData, unsigned cntFloats)
+{
+    if (!_BufferCreated)
+    {
+        std::cout << "fatal: You must call 'SetData' before setting instance data!" << std::endl;
+        return *this;
+    }
+
+    if (!_InstanceBufferCreated)
+    {
+        glGenBuffers(1, &_InstanceVBO);
+        _InstanceBufferCreated = true;
+        _InstanceVBOSize = 0;
+    }
+
+    // the vertex array refers to the buffer by name, so reallocating its storage keeps the instance usages
+    glBindBuffer(GL_ARRAY_BUFFER, _InstanceVBO);
+    if (cntFloats > _InstanceVBOSize)
+    {
+        _InstanceVBOSize = cntFloats;
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * cntFloats, pData, GL_DYNAMIC_DRAW);
+    }
+    else if (cntFloats > 0)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * cntFloats, pData);
+    }
+
+    return *this;
+}
+
+VertexBuffer &VertexBuffer::SetInstanceUsage(unsigned location, unsigned nFloats)
+{
+    if (_InstanceBufferCreated)
+    {
+        _InstanceUsages.push_back({location, nFloats});
+        _InstanceTotalOffset += nFloats;
+    }
+    else
+    {
+        std::cout << "fatal: You must call 'SetInstanceData' before setting instance usages!" << std::endl;
+    }
+
+    return *this;
+}
+
+VertexBuffer &VertexBuffer::EndSetInstanceUsage()
+{
+    unsigned preOffset = 0;
+
+    glBindVertexArray(_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _InstanceVBO);
+    for (auto &[location, nFloats] : _InstanceUsages)
+    {
+        glVertexAttribPointer(location, nFloats, GL_FLOAT, GL_FALSE, _InstanceTotalOffset * sizeof(float),
+                              (void *)(preOffset * sizeof(float)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+        preOffset += nFloats;
+    }
+    _InstanceUsages.resize(0);
+
+    return *this;
+}
+
 void VertexBuffer::DrawTriangles(unsigned verticesOffset, unsigned verticesCnt)
 {
     glBindVertexArray(_VAO);
     glDrawArrays(GL_TRIANGLES, verticesOffset, verticesCnt);
 }
 
+void VertexBuffer::DrawTrianglesInstanced(unsigned verticesOffset, unsigned verticesCnt, unsigned instancesCnt)
+{
+    glBindVertexArray(_VAO);
+    glDrawArraysInstanced(GL_TRIANGLES, verticesOffset, verticesCnt, instancesCnt);
+}
+
 void VertexBuffer::DrawWireframeTriangles(unsigned verticesOffset, unsigned verticesCnt)
 {
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -6,13 +6,25 @@
 class VertexBuffer
 {
 public:
+    VertexBuffer() = default;
+    VertexBuffer(const VertexBuffer &) = delete; // owns the GL objects
+    VertexBuffer &operator=(const VertexBuffer &) = delete;
+    ~VertexBuffer();
+
     VertexBuffer &SetData(float *pData, unsigned cntFloats);
     VertexBuffer &UpdateData(unsigned offsetFloats, unsigned newDataSizeFloats, float *pNewData);
     VertexBuffer &SetUsage(unsigned location, unsigned nFloats);
     VertexBuffer &EndSetUsage();
 
+    // per-instance attributes: a second buffer in the same vertex array, advanced once per instance
+    // set them up after the vertex data, the buffer only grows so that it can be refilled cheaply
+    VertexBuffer &SetInstanceData(float *pData, unsigned cntFloats);
+    VertexBuffer &SetInstanceUsage(unsigned location, unsigned nFloats);
+    VertexBuffer &EndSetInstanceUsage();
+
     void DrawWireframeTriangles(unsigned verticesOffset, unsigned verticesCnt);
     void DrawTriangles(unsigned verticesOffset, unsigned verticesCnt);
+    void DrawTrianglesInstanced(unsigned verticesOffset, unsigned verticesCnt, unsigned instancesCnt);
     void DrawLines(unsigned verticesOffset, unsigned verticesCnt);
 
 private:
@@ -22,4 +34,10 @@ private:
     unsigned _TotalOffset = 0;
     unsigned _VBOSize = 0;
     std::vector<std::pair<unsigned, unsigned>> _VerticesUsages;
+
+    unsigned _InstanceVBO;
+    bool _InstanceBufferCreated = false;
+    unsigned _InstanceTotalOffset = 0;
+    unsigned _InstanceVBOSize = 0; // capacity
+    std::vector<std::pair<unsigned, unsigned>> _InstanceUsages;
 };
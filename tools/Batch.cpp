@@ -0,0 +1,369 @@
+// HLP-Batch: solves every puzzle file of a folder and reports one record per file, either CSV (default) or JSON lines (--json)
+// the puzzles are solved by several jobs at once, each job takes the next file when it's done with its puzzle
+// (the levels of a puzzle still run on the thread pool), so a slow puzzle only holds up its own job
+// a puzzle is cancelled when it runs out of time (--timeout) or memory (--max-memory), the batch goes on
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Utils.h"
+
+#include "HLP/DisassemblyGraph.h"
+#include "HLP/PuzzleFile.h"
+#include "HLP/SolutionCache.h"
+
+namespace {
+    constexpr auto cWatchInterval = std::chrono::milliseconds(20); // how often the timeouts are checked
+
+    struct BatchRecord
+    {
+        std::string _Puzzle;
+        const char *_Status = "";         // solved, cached, unsolvable, timeout, out_of_memory, import_failed
+        int _PieceNum = 0;
+        int _Difficulty = -1;             // -1 if unsolved
+        int _PlanSize = 0;
+        int _NodeNum = 0;                 // of all graphs of the puzzle
+        int _ExpandedNum = 0;             // ditto
+        std::size_t _PeakMemoryUsage = 0; // in bytes, the sum of the peaks of all graphs (they may overlap in time)
+        double _Time = 0;                 // ms
+    };
+
+    // the puzzle a job is working on, the main thread cancels it when it takes too long
+    struct JobSlot
+    {
+        std::mutex _Mutex;
+        DisassemblyGraph *_Graph = nullptr;
+        std::chrono::steady_clock::time_point _StartTime;
+        bool _TimedOut = false;
+    };
+
+    bool gOutputJson = false;
+    bool gComplete = false;
+    bool gCompactStorage = false;
+    std::size_t gMemoryLimit = std::size_t(2048) << 20;
+    double gTimeout = 0; // seconds, 0: no limit
+    SolutionCache gSolutionCache;
+
+    FILE *gReportFile = stdout;
+    std::mutex gReportMutex;
+
+    void PrintHeader()
+    {
+        if (!gOutputJson)
+        {
+            std::fprintf(gReportFile, "puzzle,status,pieces,difficulty,plan_size,nodes,expanded,peak_memory,time_ms\n");
+        }
+    }
+
+    // a file name may contain anything but '/', so it's quoted in the CSV (if needed) and escaped in the JSON
+    std::string QuoteCsv(const std::string &text)
+    {
+        if (text.find_first_of(",\"\r\n") == std::string::npos)
+        {
+            return text;
+        }
+
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"') // doubled
+            {
+                quoted += c;
+            }
+            quoted += c;
+        }
+
+        return quoted + "\"";
+    }
+
+    std::string EscapeJson(const std::string &text)
+    {
+        std::string escaped;
+        for (unsigned char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (c < 0x20)
+            {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+
+        return escaped;
+    }
+
+    void PrintRecord(const BatchRecord &r)
+    {
+        std::lock_guard lock(gReportMutex);
+        if (gOutputJson)
+        {
+            std::fprintf(gReportFile,
+                         "{\"puzzle\":\"%s\",\"status\":\"%s\",\"pieces\":%d,\"difficulty\":%d,\"plan_size\":%d,"
+                         "\"nodes\":%d,\"expanded\":%d,\"peak_memory\":%zu,\"time_ms\":%.3f}\n",
+                         EscapeJson(r._Puzzle).c_str(), r._Status, r._PieceNum, r._Difficulty, r._PlanSize, r._NodeNum, r._ExpandedNum,
+                         r._PeakMemoryUsage, r._Time);
+        }
+        else
+        {
+            std::fprintf(gReportFile, "%s,%s,%d,%d,%d,%d,%d,%zu,%.3f\n", QuoteCsv(r._Puzzle).c_str(), r._Status, r._PieceNum,
+                         r._Difficulty, r._PlanSize, r._NodeNum, r._ExpandedNum, r._PeakMemoryUsage, r._Time);
+        }
+        std::fflush(gReportFile);
+    }
+
+    // node num and peak memory usage of the graph and of the graphs of its removed subassemblies
+    void AccumulateGraphStats(DisassemblyGraph &graph, BatchRecord &record)
+    {
+        record._NodeNum += graph.GetPuzzleConfigNum();
+        record._PeakMemoryUsage += graph.GetBuildProgress()._PeakMemoryUsage;
+        for (int i = 0; i < graph.GetSubassemblyPlanNum(); i++)
+        {
+            AccumulateGraphStats(*graph.GetSubassemblyPlan(i)._Graph, record);
+        }
+    }
+
+    BatchRecord SolvePuzzle(const fs::path &puzzleFilePath, JobSlot &slot)
+    {
+        namespace ch = std::chrono;
+
+        BatchRecord record;
+        record._Puzzle = puzzleFilePath.filename().string();
+
+        DisassemblyGraph graph;
+        graph.SetCompactStorage(gCompactStorage);
+        graph.SetMemoryLimit(gMemoryLimit);
+
+        auto t1 = ch::steady_clock::now();
+        if (!graph.ImportPuzzle(puzzleFilePath.string()))
+        {
+            std::fprintf(stderr, "%s: %s\n", record._Puzzle.c_str(), graph.GetImportError().c_str());
+            record._Status = "import_failed";
+            return record;
+        }
+        record._PieceNum = graph.GetPuzzleConfig(0).GetPuzzlePieceNum();
+
+        bool cached = gSolutionCache.Load(graph, gComplete), timedOut = false;
+        if (!cached)
+        {
+            {
+                std::lock_guard lock(slot._Mutex);
+                slot._Graph = &graph;
+                slot._StartTime = t1;
+                slot._TimedOut = false;
+            }
+
+            if (gComplete)
+            {
+                graph.BuildCompleteDisassemblyGraph();
+            }
+            else
+            {
+                graph.BuildKernelDisassemblyGraph();
+            }
+
+            std::lock_guard lock(slot._Mutex);
+            slot._Graph = nullptr;
+            timedOut = slot._TimedOut;
+        }
+        auto t2 = ch::steady_clock::now();
+
+        if (timedOut)
+        {
+            record._Status = "timeout";
+        }
+        else if (graph.IsMemoryLimitExceeded())
+        {
+            record._Status = "out_of_memory";
+        }
+        else if (!graph.IsDisasmGraphBuilt())
+        {
+            record._Status = "unsolvable";
+        }
+        else
+        {
+            record._Status = cached ? "cached" : "solved";
+            record._Difficulty = graph.GetPuzzleDifficulty();
+            record._PlanSize = graph.GetDisasmPlanSize();
+            if (!cached)
+            {
+                gSolutionCache.Store(graph, gComplete);
+            }
+        }
+
+        AccumulateGraphStats(graph, record);
+        record._ExpandedNum = graph.GetBuildProgress()._ExpandedNum;
+        record._Time = ch::duration<double, std::milli>(t2 - t1).count();
+
+        return record;
+    }
+
+    void PrintUsage()
+    {
+        std::printf("usage: HLP-Batch [--complete] [--compact] [--jobs N] [--threads N] [--timeout S] [--max-memory MB] [--cache DIR]\n"
+                    "                 [--json] [--report FILE] <puzzle folder>\n"
+                    "  --complete      build the complete disassembly graphs instead of the kernel ones\n"
+                    "  --compact       compact graph storage: parent + move per node, configs are rebuilt on demand\n"
+                    "  --jobs N        number of puzzles solved at once (default: one per solver thread)\n"
+                    "  --threads N     number of solver threads (default: one per hardware thread)\n"
+                    "  --timeout S     cancel a puzzle after S seconds (default: no limit)\n"
+                    "  --max-memory M  cancel a puzzle once its graphs use more than M MB in total (default: 2048, 0: no limit)\n"
+                    "  --cache DIR     reuse the plans solved before, solved plans are stored there\n"
+                    "  --json          print JSON lines instead of CSV\n"
+                    "  --report FILE   write the report to FILE instead of stdout\n");
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int jobNum = 0, threadNum = 0;
+    std::string puzzleFolderPath, reportFilePath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--complete")
+        {
+            gComplete = true;
+        }
+        else if (arg == "--compact")
+        {
+            gCompactStorage = true;
+        }
+        else if (arg == "--jobs" && i + 1 < argc)
+        {
+            jobNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threadNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--timeout" && i + 1 < argc)
+        {
+            gTimeout = std::atof(argv[++i]);
+        }
+        else if (arg == "--max-memory" && i + 1 < argc)
+        {
+            gMemoryLimit = std::size_t(std::atoll(argv[++i])) << 20;
+        }
+        else if (arg == "--cache" && i + 1 < argc)
+        {
+            gSolutionCache.Init(argv[++i]);
+        }
+        else if (arg == "--json")
+        {
+            gOutputJson = true;
+        }
+        else if (arg == "--report" && i + 1 < argc)
+        {
+            reportFilePath = argv[++i];
+        }
+        else if (arg.starts_with("-") || !puzzleFolderPath.empty())
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+        else
+        {
+            puzzleFolderPath = arg;
+        }
+    }
+
+    if (puzzleFolderPath.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // only the puzzle files, in a stable order
+    std::vector<fs::path> puzzleFilePaths;
+    TraverseFolder(puzzleFolderPath, [&](const fs::path &filePath) {
+        if (DetectPuzzleFileFormat(filePath.string()) != PuzzleFileFormat::INVALID)
+        {
+            puzzleFilePaths.push_back(filePath);
+        }
+    });
+    std::sort(puzzleFilePaths.begin(), puzzleFilePaths.end());
+
+    if (!reportFilePath.empty() && !(gReportFile = std::fopen(reportFilePath.c_str(), "w")))
+    {
+        std::fprintf(stderr, "unable to write the report to %s\n", reportFilePath.c_str());
+        return 1;
+    }
+
+    gThreadPool.Init(threadNum);
+    jobNum = std::clamp(jobNum > 0 ? jobNum : gThreadPool.GetThreadNum(), 1, std::max<int>(1, puzzleFilePaths.size()));
+
+    PrintHeader();
+
+    // every job takes the next file until there is none, the main thread watches the timeouts meanwhile
+    namespace ch = std::chrono;
+    auto batchStartTime = ch::steady_clock::now();
+    std::atomic<int> nextPuzzleIndex = 0, finishedJobNum = 0, solvedNum = 0;
+    std::vector<JobSlot> slots(jobNum);
+    std::vector<std::thread> jobs;
+    for (int jobIndex = 0; jobIndex < jobNum; jobIndex++)
+    {
+        jobs.emplace_back([&, jobIndex]() {
+            int puzzleIndex = 0;
+            while ((puzzleIndex = nextPuzzleIndex.fetch_add(1)) < static_cast<int>(puzzleFilePaths.size()))
+            {
+                auto record = SolvePuzzle(puzzleFilePaths[puzzleIndex], slots[jobIndex]);
+                solvedNum += record._Difficulty != -1;
+                PrintRecord(record);
+            }
+            finishedJobNum++;
+        });
+    }
+
+    while (finishedJobNum.load() < jobNum)
+    {
+        std::this_thread::sleep_for(cWatchInterval);
+        if (gTimeout <= 0)
+        {
+            continue;
+        }
+
+        auto now = ch::steady_clock::now();
+        for (auto &slot : slots)
+        {
+            std::lock_guard lock(slot._Mutex);
+            if (slot._Graph && !slot._TimedOut && ch::duration<double>(now - slot._StartTime).count() > gTimeout)
+            {
+                slot._TimedOut = true;
+                slot._Graph->CancelBuild();
+            }
+        }
+    }
+
+    for (auto &job : jobs)
+    {
+        job.join();
+    }
+
+    if (gReportFile != stdout)
+    {
+        std::fclose(gReportFile);
+    }
+
+    std::fprintf(stderr, "%d / %zu puzzle(s) solved in %.3f s (%d job(s), %d thread(s))\n", solvedNum.load(), puzzleFilePaths.size(),
+                 ch::duration<double>(ch::steady_clock::now() - batchStartTime).count(), jobNum, gThreadPool.GetThreadNum());
+
+    return 0;
+}
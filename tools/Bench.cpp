@@ -0,0 +1,449 @@
+// HLP-Bench: times the solver stages separately on puzzles of growing size
+// every (puzzle, stage) pair produces one record, either CSV (default) or JSON lines (--json)
+// so that the results of different runs can be diffed / plotted to track regressions
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Utils.h"
+
+#include "HLP/DisassemblyGraph.h"
+#include "HLP/HLP_Config.h"
+#include "HLP/PuzzleFile.h"
+#include "HLP/PuzzleGenerator.h"
+
+namespace {
+    constexpr double cMinMeasureTime = 200.0; // ms, cheap stages are repeated until they take at least this long
+    constexpr int cMaxMeasureIterations = 100000;
+
+    struct SyntheticPuzzleDesc
+    {
+        int _BoardSize = 4;     // _BoardSize x _BoardSize free cells in a frame (with an opening of 2 cells)
+        int _PieceNum = 5;      // besides the frame
+        int _EmptyCellNum = 2;
+        int _Difficulty = 2;    // the kernel depth the puzzle is generated for
+        int _Scale = 1;         // every cell becomes _Scale x _Scale voxels, a bigger board for the same puzzle
+        std::uint64_t _Seed = 1;
+
+        std::string GetName() const
+        {
+            return "board" + std::to_string(_BoardSize) + "_pieces" + std::to_string(_PieceNum) + "_d" + std::to_string(_Difficulty) +
+                   (_Scale > 1 ? "_scale" + std::to_string(_Scale) : "");
+        }
+    };
+
+    // the puzzle is generated by the PuzzleGenerator on one worker, so the same desc always produces the same puzzle
+    // the pieces are interlocked: nothing can be removed before _Difficulty moves (at _Scale 1, scaled puzzles may differ)
+    std::vector<PuzzlePiece> GenerateSyntheticPuzzle(const SyntheticPuzzleDesc &desc)
+    {
+        PuzzleGeneratorSettings settings;
+        settings._Board = BoardShape::MakeRectangle(desc._BoardSize, desc._BoardSize, 2);
+        settings._PieceNum = desc._PieceNum;
+        settings._EmptyCellNum = desc._EmptyCellNum;
+        settings._TargetDifficulty = desc._Difficulty;
+        settings._PuzzleNum = 1;
+        settings._Seed = desc._Seed;
+        settings._WorkerNum = 1;
+
+        std::vector<PuzzlePiece> pieces;
+        PuzzleGenerator generator;
+        generator.Generate(settings, [&](std::vector<PuzzlePiece> &&generatedPieces, std::uint64_t) {
+            pieces = std::move(generatedPieces);
+        });
+
+        for (auto &piece : pieces)
+        {
+            std::vector<Voxel> voxels;
+            for (auto &voxel : piece._Voxels)
+            {
+                for (int dx = 0; dx < desc._Scale; dx++)
+                {
+                    for (int dz = 0; dz < desc._Scale; dz++)
+                    {
+                        voxels.emplace_back(voxel._X * desc._Scale + dx, voxel._Z * desc._Scale + dz);
+                    }
+                }
+            }
+            piece._Voxels = std::move(voxels);
+        }
+
+        return pieces;
+    }
+
+    struct BenchRecord
+    {
+        std::string _Puzzle;
+        int _PieceNum = 0, _VoxelNum = 0, _SizeX = 0, _SizeZ = 0;
+        std::string _Stage;
+        int _Iterations = 0;
+        double _TotalTime = 0;    // ms
+        long long _Count = 0;     // stage dependent: subsets, calls, neighbors or graph nodes
+        int _Difficulty = -1;     // only for graph builds, -1 if unsolved
+        double _BytesPerNode = 0; // only for graph builds
+    };
+
+    bool gOutputJson = false;
+    bool gCompactStorage = false;
+
+    const char *GetBackendName()
+    {
+        return PuzzleConfig::GetCollisionBackend() == CollisionBackend::RLE ? "rle" : "bitboard";
+    }
+
+    const char *GetStorageName()
+    {
+        return gCompactStorage ? "compact" : "full";
+    }
+
+    void PrintHeader()
+    {
+        if (!gOutputJson)
+        {
+            std::printf("puzzle,pieces,voxels,size_x,size_z,stage,iterations,total_ms,mean_us,count,difficulty,backend,storage,"
+                        "bytes_per_node\n");
+        }
+    }
+
+    void PrintRecord(const BenchRecord &r)
+    {
+        double meanTime = r._TotalTime * 1000.0 / std::max(1, r._Iterations);
+        if (gOutputJson)
+        {
+            std::printf("{\"puzzle\":\"%s\",\"pieces\":%d,\"voxels\":%d,\"size_x\":%d,\"size_z\":%d,\"stage\":\"%s\",\"iterations\":%d,"
+                        "\"total_ms\":%.3f,\"mean_us\":%.3f,\"count\":%lld,\"difficulty\":%d,\"backend\":\"%s\",\"storage\":\"%s\","
+                        "\"bytes_per_node\":%.1f}\n",
+                        r._Puzzle.c_str(), r._PieceNum, r._VoxelNum, r._SizeX, r._SizeZ, r._Stage.c_str(), r._Iterations, r._TotalTime,
+                        meanTime, r._Count, r._Difficulty, GetBackendName(), GetStorageName(), r._BytesPerNode);
+        }
+        else
+        {
+            std::printf("%s,%d,%d,%d,%d,%s,%d,%.3f,%.3f,%lld,%d,%s,%s,%.1f\n", r._Puzzle.c_str(), r._PieceNum, r._VoxelNum, r._SizeX,
+                        r._SizeZ, r._Stage.c_str(), r._Iterations, r._TotalTime, meanTime, r._Count, r._Difficulty, GetBackendName(),
+                        GetStorageName(), r._BytesPerNode);
+        }
+        std::fflush(stdout);
+    }
+
+    // repeat func until cMinMeasureTime is reached, returns <iterations, total time in ms>
+    template <typename Func>
+    std::pair<int, double> Measure(Func &&func)
+    {
+        namespace ch = std::chrono;
+
+        int iterations = 0;
+        double totalTime = 0;
+        while (totalTime < cMinMeasureTime && iterations < cMaxMeasureIterations)
+        {
+            auto t1 = ch::steady_clock::now();
+            func();
+            auto t2 = ch::steady_clock::now();
+
+            totalTime += ch::duration<double, std::milli>(t2 - t1).count();
+            ++iterations;
+        }
+
+        return {iterations, totalTime};
+    }
+
+    // pieces == nullptr: import from puzzleFilePath
+    void BenchPuzzle(const std::string &name, const std::string &puzzleFilePath, std::vector<PuzzlePiece> *pieces)
+    {
+        DisassemblyGraph graph;
+        graph.SetCompactStorage(gCompactStorage);
+        auto Import = [&]() {
+            return pieces ? graph.ImportPuzzle(std::vector<PuzzlePiece>(*pieces)) : graph.ImportPuzzle(puzzleFilePath);
+        };
+
+        if (!Import())
+        {
+            std::fprintf(stderr, "%s: failed to import\n", name.c_str());
+            return;
+        }
+
+        auto &root = graph.GetPuzzleConfig(0);
+        auto [minX, minZ, sizeX, sizeZ] = root.GetPuzzleSize();
+
+        BenchRecord base;
+        base._Puzzle = name;
+        base._PieceNum = root.GetPuzzlePieceNum();
+        base._SizeX = sizeX;
+        base._SizeZ = sizeZ;
+        root.TraverseOccupiedRuns([&](int, int, int, int length) { base._VoxelNum += length; });
+
+        // 0. import, from both file formats (written to the temp folder)
+        {
+            std::vector<PuzzlePiece> filePieces;
+            if (pieces)
+            {
+                filePieces = *pieces;
+            }
+            else
+            {
+                ReadTextPuzzleFile(puzzleFilePath, filePieces);
+            }
+
+            auto tempFilePath = (fs::temp_directory_path() / ("HLP-Bench_" + name)).string();
+            for (auto format : {PuzzleFileFormat::TEXT, PuzzleFileFormat::BINARY})
+            {
+                bool text = (format == PuzzleFileFormat::TEXT);
+                if (!(text ? WriteTextPuzzleFile(tempFilePath, filePieces) : WriteBinaryPuzzleFile(tempFilePath, filePieces)))
+                {
+                    continue;
+                }
+
+                DisassemblyGraph importGraph;
+                auto record = base;
+                record._Stage = text ? "import_text" : "import_binary";
+                std::tie(record._Iterations, record._TotalTime) = Measure([&]() { importGraph.ImportPuzzle(tempFilePath); });
+                PrintRecord(record);
+            }
+            fs::remove(tempFilePath);
+        }
+
+        // 1. acceleration structures
+        {
+            auto record = base;
+            record._Stage = "accel";
+            std::tie(record._Iterations, record._TotalTime) = Measure([&]() { root.BuildAccelStructures(); });
+            PrintRecord(record);
+        }
+
+        // 2. subassembly enumeration
+        root.BuildAccelStructures();
+
+        std::vector<PieceMask> subassemblies;
+        {
+            root._EnumerateSubassembly([&](PieceMask subasmMask) {
+                subassemblies.push_back(subasmMask);
+                return true;
+            });
+
+            auto record = base;
+            record._Stage = "enumerate";
+            record._Count = subassemblies.size();
+            std::tie(record._Iterations, record._TotalTime) = Measure([&]() {
+                long long subassemblyNum = 0;
+                root._EnumerateSubassembly([&](PieceMask) {
+                    ++subassemblyNum;
+                    return true;
+                });
+            });
+            PrintRecord(record);
+        }
+
+        // 3. max movable distance, for every subassembly in every direction
+        {
+            auto record = base;
+            record._Stage = "max_movable_distance";
+            record._Count = subassemblies.size() * 4;
+            volatile std::int64_t sink = 0; // _Inf is summed up as well, an int would overflow
+            std::tie(record._Iterations, record._TotalTime) = Measure([&]() {
+                for (auto subassembly : subassemblies)
+                {
+                    for (int d = 0; d < 4; d++)
+                    {
+                        sink = sink + root._CalculateMaxMovableDistance(subassembly, d);
+                    }
+                }
+            });
+            PrintRecord(record);
+        }
+
+        // 4. neighbor generation (including building the acceleration structures, as the BFS does)
+        root.ReleaseAccelStructures();
+        {
+            auto record = base;
+            record._Stage = "neighbors";
+            std::tie(record._Iterations, record._TotalTime) = Measure([&]() {
+                std::vector<PuzzleConfig> neighborConfigs;
+                Arena<PuzzlePieceState> stateArena;
+                root.CalculateNeighborConfigs(neighborConfigs, stateArena);
+                record._Count = neighborConfigs.size();
+            });
+            PrintRecord(record);
+        }
+
+        // 5. acceleration structures of moved configs, patched from their parents' ones (compare with "accel")
+        //    the <parent, moved config> pairs are taken from the first two levels of the BFS
+        {
+            Arena<PuzzlePieceState> stateArena;
+            std::vector<PuzzleConfig> levelConfigs;
+            std::vector<std::vector<PuzzleConfig>> neighborConfigs; // one vector per level config, they must not move
+            std::vector<std::pair<PuzzleConfig *, PuzzleConfig *>> movedPairs;
+            auto CollectMoved = [&](PuzzleConfig &parent, std::vector<PuzzleConfig> &neighbors) {
+                for (auto &neighborConfig : neighbors)
+                {
+                    if (neighborConfig.GetPuzzlePieceNum() == parent.GetPuzzlePieceNum())
+                    {
+                        movedPairs.push_back({&parent, &neighborConfig});
+                    }
+                }
+            };
+
+            root.CalculateNeighborConfigs(levelConfigs, stateArena);
+            CollectMoved(root, levelConfigs);
+            neighborConfigs.resize(levelConfigs.size());
+            for (std::size_t i = 0; i < levelConfigs.size(); i++)
+            {
+                levelConfigs[i].CalculateNeighborConfigs(neighborConfigs[i], stateArena);
+                CollectMoved(levelConfigs[i], neighborConfigs[i]);
+            }
+
+            for (auto &[parent, config] : movedPairs)
+            {
+                if (!parent->HasAccelStructures())
+                {
+                    parent->BuildAccelStructures();
+                }
+            }
+
+            auto record = base;
+            record._Stage = "derive_accel";
+            record._Count = movedPairs.size();
+            std::tie(record._Iterations, record._TotalTime) = Measure([&]() {
+                for (auto &[parent, config] : movedPairs)
+                {
+                    config->DeriveAccelStructures(*parent);
+                }
+            });
+            record._TotalTime /= std::max<std::size_t>(1, movedPairs.size()); // per config, like "accel"
+            PrintRecord(record);
+
+            root.ReleaseAccelStructures();
+        }
+
+        // 6. full graph builds, only once: they can be expensive
+        for (int complete = 0; complete < 2; complete++)
+        {
+            namespace ch = std::chrono;
+
+            Import();
+
+            auto record = base;
+            record._Stage = complete ? "complete_graph" : "kernel_graph";
+            record._Iterations = 1;
+
+            auto t1 = ch::steady_clock::now();
+            if (complete)
+            {
+                graph.BuildCompleteDisassemblyGraph();
+            }
+            else
+            {
+                graph.BuildKernelDisassemblyGraph();
+            }
+            auto t2 = ch::steady_clock::now();
+
+            record._TotalTime = ch::duration<double, std::milli>(t2 - t1).count();
+            record._Count = graph.GetPuzzleConfigNum();
+            record._Difficulty = graph.IsDisasmGraphBuilt() ? graph.GetPuzzleDifficulty() : -1;
+            record._BytesPerNode = graph.GetMemoryUsagePerNode();
+            PrintRecord(record);
+        }
+    }
+
+    void PrintUsage()
+    {
+        std::printf("usage: HLP-Bench [--json] [--quick] [--threads N] [--filter TEXT] [--backend rle|bitboard] [--compact]\n"
+                    "  --json       print JSON lines instead of CSV\n"
+                    "  --quick      only the small synthetic puzzles\n"
+                    "  --threads N  number of solver threads (default: one per hardware thread)\n"
+                    "  --filter T   only puzzles whose name contains T\n"
+                    "  --backend B  collision backend used by the solver (default: bitboard)\n"
+                    "  --compact    compact graph storage (parent + move per node)\n");
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    bool quick = false;
+    int threadNum = 0;
+    std::string filter;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--json")
+        {
+            gOutputJson = true;
+        }
+        else if (arg == "--quick")
+        {
+            quick = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threadNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--filter" && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (arg == "--backend" && i + 1 < argc && (std::string(argv[i + 1]) == "rle" || std::string(argv[i + 1]) == "bitboard"))
+        {
+            PuzzleConfig::SetCollisionBackend(std::string(argv[++i]) == "rle" ? CollisionBackend::RLE : CollisionBackend::BITBOARD);
+        }
+        else if (arg == "--compact")
+        {
+            gCompactStorage = true;
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+
+    gThreadPool.Init(threadNum);
+
+    PrintHeader();
+
+    // the hand-made puzzles first
+    TraverseFolder(cPuzzleFileFolder, [&](const fs::path &filePath) {
+        std::string name = filePath.filename().string();
+        if (filePath.extension() == ".cfg" && name.find(filter) != std::string::npos)
+        {
+            BenchPuzzle(name, filePath.string(), nullptr);
+        }
+    });
+
+    // then synthetic ones, along three axes: interlocking depth (difficulty), number of pieces and board size
+    // (subassembly enumeration is exponential in the number of pieces, so the boards stay small, they grow through _Scale)
+    std::vector<SyntheticPuzzleDesc> descs;
+    for (int difficulty = 2; difficulty <= (quick ? 4 : 10); difficulty += 2)
+    {
+        descs.push_back({5, 6, 3, difficulty});
+    }
+    for (auto [boardSize, pieceNum, emptyCellNum] : {std::tuple{4, 3, 2}, {4, 5, 2}, {5, 6, 3}, {6, 8, 4}})
+    {
+        if (!quick || boardSize <= 4)
+        {
+            descs.push_back({boardSize, pieceNum, emptyCellNum, 3});
+        }
+    }
+    for (int scale : {2, 4, 8})
+    {
+        if (!quick || scale == 2)
+        {
+            descs.push_back({4, 5, 2, 4, scale});
+        }
+    }
+
+    for (auto &desc : descs)
+    {
+        auto name = desc.GetName();
+        if (name.find(filter) != std::string::npos)
+        {
+            auto pieces = GenerateSyntheticPuzzle(desc);
+            BenchPuzzle(name, "", &pieces);
+        }
+    }
+
+    return 0;
+}
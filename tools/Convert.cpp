@@ -0,0 +1,96 @@
+// HLP-Convert: converts puzzle files between the text and the binary format (see src/HLP/PuzzleFile.h)
+// the format of the input is detected, the output is binary unless --text is given
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "HLP/PuzzleFile.h"
+
+namespace {
+    void PrintUsage()
+    {
+        std::printf("usage: HLP-Convert [--text] <input puzzle file> <output puzzle file>\n"
+                    "  --text  write the text format instead of the binary one\n");
+    }
+
+    bool ReadPuzzleFile(const std::string &puzzleFilePath, std::vector<PuzzlePiece> &pieces)
+    {
+        switch (DetectPuzzleFileFormat(puzzleFilePath))
+        {
+        case PuzzleFileFormat::TEXT:
+            return ReadTextPuzzleFile(puzzleFilePath, pieces);
+
+        case PuzzleFileFormat::BINARY: {
+            PuzzleGeometry geometry;
+            if (!MapBinaryPuzzleFile(puzzleFilePath, geometry))
+            {
+                return false;
+            }
+
+            pieces.clear();
+            for (auto &piece : geometry._Pieces)
+            {
+                pieces.push_back({std::vector<Voxel>(piece._Voxels.begin(), piece._Voxels.end())});
+            }
+            return true;
+        }
+
+        default:
+            return false;
+        }
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    bool text = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--text")
+        {
+            text = true;
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.size() != 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<PuzzlePiece> pieces;
+    if (!ReadPuzzleFile(paths[0], pieces))
+    {
+        std::printf("%s: not a valid puzzle file\n", paths[0].c_str());
+        return 1;
+    }
+
+    if (!(text ? WriteTextPuzzleFile(paths[1], pieces) : WriteBinaryPuzzleFile(paths[1], pieces)))
+    {
+        std::printf("%s: failed to write\n", paths[1].c_str());
+        return 1;
+    }
+
+    std::size_t voxelNum = 0;
+    for (auto &piece : pieces)
+    {
+        voxelNum += piece._Voxels.size();
+    }
+    std::printf("%s -> %s (%s): %zu pieces, %zu voxels\n", paths[0].c_str(), paths[1].c_str(), text ? "text" : "binary",
+                pieces.size(), voxelNum);
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+// HLP-Generate: generates puzzles of a given difficulty and writes them to a folder, one puzzle file each
+// made to run unattended (e.g. overnight): the progress and the throughput are printed to stderr every few seconds
+// the board is a framed rectangle (--size, --opening) or read from a text file (--board): one row per z,
+// '#' for a free cell, 'F' for a cell of the frame, anything else for none
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Utils.h"
+
+#include "HLP/PuzzleFile.h"
+#include "HLP/PuzzleGenerator.h"
+
+namespace {
+    constexpr auto cReportInterval = std::chrono::seconds(5);
+
+    void PrintUsage()
+    {
+        std::printf("usage: HLP-Generate [--size WxH] [--opening N] [--board FILE] [--pieces N] [--empty N] [--difficulty D]\n"
+                    "                    [--count N] [--budget N] [--mutation R] [--threads N] [--seed S] [--text] <output folder>\n"
+                    "  --size WxH      W x H free cells in a frame (default: 4x4)\n"
+                    "  --opening N     width of the opening of the frame (default: 2, 0: no frame)\n"
+                    "  --board FILE    the board from a text file, one row per line, '#' for a free cell, 'F' for the frame\n"
+                    "  --pieces N      number of pieces the free cells are split into, besides the frame (default: 5)\n"
+                    "  --empty N       number of free cells left empty (default: 2)\n"
+                    "  --difficulty D  the kernel depth of the puzzles (default: 4)\n"
+                    "  --count N       stop after N puzzles (default: 1, 0: until interrupted)\n"
+                    "  --budget N      reject a candidate after N expanded configs (default: 20000, 0: no limit)\n"
+                    "  --mutation R    how often a candidate is a mutation of a promising one (default: 0.75)\n"
+                    "  --threads N     number of threads (default: one per hardware thread)\n"
+                    "  --seed S        of the random candidates (default: 0)\n"
+                    "  --text          write the text format instead of the binary one\n");
+    }
+
+    bool ReadBoardFile(const std::string &boardFilePath, BoardShape &board)
+    {
+        std::ifstream file(boardFilePath);
+        if (!file)
+        {
+            return false;
+        }
+
+        std::vector<std::string> rows;
+        for (std::string row; std::getline(file, row);)
+        {
+            rows.push_back(row);
+            board._SizeX = std::max<int>(board._SizeX, row.size());
+        }
+        board._SizeZ = rows.size();
+        board._Cells.assign(board._SizeX * board._SizeZ, BoardShape::NONE);
+        for (int z = 0; z < board._SizeZ; z++)
+        {
+            for (int x = 0; x < static_cast<int>(rows[z].size()); x++)
+            {
+                char c = rows[z][x];
+                board._Cells[x * board._SizeZ + z] = (c == '#') ? BoardShape::FREE : (c == 'F' ? BoardShape::FRAME : BoardShape::NONE);
+            }
+        }
+
+        return board.GetCellNum() > 0;
+    }
+
+    void PrintStats(const PuzzleGeneratorStats &stats)
+    {
+        std::fprintf(stderr,
+                     "%lld puzzle(s), %lld candidate(s) in %.1f s (%.1f / s), rejected: %lld too easy, %lld over budget, %lld unsolvable, "
+                     "%lld duplicate\n",
+                     (long long)stats._AcceptedNum, (long long)stats._CandidateNum, stats._Time, stats.GetCandidatesPerSecond(),
+                     (long long)stats._TooEasyNum, (long long)stats._OverBudgetNum, (long long)stats._UnsolvableNum,
+                     (long long)stats._DuplicateNum);
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    PuzzleGeneratorSettings settings;
+    int sizeX = 4, sizeZ = 4, openingWidth = 2;
+    bool boardFromFile = false;
+    int threadNum = 0;
+    bool textFormat = false;
+    std::string outputFolderPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc && std::sscanf(argv[i + 1], "%dx%d", &sizeX, &sizeZ) == 2)
+        {
+            i++;
+        }
+        else if (arg == "--opening" && i + 1 < argc)
+        {
+            openingWidth = std::atoi(argv[++i]);
+        }
+        else if (arg == "--board" && i + 1 < argc)
+        {
+            settings._Board = BoardShape();
+            if (!ReadBoardFile(argv[++i], settings._Board))
+            {
+                std::fprintf(stderr, "unable to read a board from %s\n", argv[i]);
+                return 1;
+            }
+            boardFromFile = true;
+        }
+        else if (arg == "--pieces" && i + 1 < argc)
+        {
+            settings._PieceNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--empty" && i + 1 < argc)
+        {
+            settings._EmptyCellNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--difficulty" && i + 1 < argc)
+        {
+            settings._TargetDifficulty = std::atoi(argv[++i]);
+        }
+        else if (arg == "--count" && i + 1 < argc)
+        {
+            settings._PuzzleNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--budget" && i + 1 < argc)
+        {
+            settings._MaxExpandedNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--mutation" && i + 1 < argc)
+        {
+            settings._MutationRate = std::atof(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threadNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            settings._Seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--text")
+        {
+            textFormat = true;
+        }
+        else if (arg.starts_with("-") || !outputFolderPath.empty())
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+        else
+        {
+            outputFolderPath = arg;
+        }
+    }
+
+    std::error_code error;
+    if (outputFolderPath.empty() || (fs::create_directories(outputFolderPath, error), error))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (!boardFromFile)
+    {
+        settings._Board = BoardShape::MakeRectangle(sizeX, sizeZ, openingWidth);
+    }
+    gThreadPool.Init(threadNum);
+
+    // the file is named by the difficulty and the hash, so the puzzles of several runs (or seeds) don't overwrite each other
+    int failedNum = 0;
+    auto WritePuzzle = [&](std::vector<PuzzlePiece> &&pieces, std::uint64_t hash) {
+        char fileName[64];
+        std::snprintf(fileName, sizeof(fileName), "d%d_%016llx.cfg", settings._TargetDifficulty, (unsigned long long)hash);
+        auto puzzleFilePath = (fs::path(outputFolderPath) / fileName).string();
+        if (!(textFormat ? WriteTextPuzzleFile(puzzleFilePath, pieces) : WriteBinaryPuzzleFile(puzzleFilePath, pieces)))
+        {
+            failedNum++;
+        }
+    };
+
+    PuzzleGenerator generator;
+    bool generated = false;
+    std::atomic<bool> finished = false;
+    std::thread generatorThread([&]() {
+        generated = generator.Generate(settings, WritePuzzle);
+        finished = true;
+    });
+
+    auto nextReportTime = std::chrono::steady_clock::now() + cReportInterval;
+    while (!finished)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (std::chrono::steady_clock::now() >= nextReportTime)
+        {
+            PrintStats(generator.GetStats());
+            nextReportTime += cReportInterval;
+        }
+    }
+    generatorThread.join();
+
+    if (!generated)
+    {
+        std::fprintf(stderr, "invalid settings: at least 2 pieces, all pieces and empty cells on the board, difficulty >= 1\n");
+        return 1;
+    }
+
+    PrintStats(generator.GetStats());
+    if (failedNum > 0)
+    {
+        std::fprintf(stderr, "unable to write %d puzzle file(s) to %s\n", failedNum, outputFolderPath.c_str());
+    }
+
+    return failedNum > 0 ? 1 : 0;
+}
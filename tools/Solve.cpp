@@ -0,0 +1,238 @@
+// HLP-Solve: headless disassembly planner
+// links only the solver (no GLFW / OpenGL / ImGui), so it runs on build machines and in batch jobs
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+#include "HLP/DisassemblyGraph.h"
+#include "HLP/SolutionCache.h"
+
+namespace {
+    void PrintUsage()
+    {
+        std::printf("usage: HLP-Solve [--complete] [--compact] [--threads N] [--cache DIR] [--profile] <puzzle file>...\n"
+                    "  --complete   build the complete disassembly graph instead of the kernel one\n"
+                    "  --compact    compact graph storage: parent + move per node, configs are rebuilt on demand\n"
+                    "  --threads N  number of solver threads (default: one per hardware thread)\n"
+                    "  --cache DIR  reuse the plans solved before, solved plans are stored there\n"
+                    "  --profile    print the timings of the solver phases to stderr (last %d runs of each)\n",
+                    cProfileSampleNum);
+    }
+
+    void PrintProfile()
+    {
+        std::fprintf(stderr, "%-24s %8s %10s %10s %10s %10s %10s %10s\n", "scope (ms)", "runs", "mean", "p50", "p95", "p99", "max",
+                     "total");
+        for (auto &stats : gProfiler.GetStats())
+        {
+            std::fprintf(stderr, "%-24s %8llu %10.3f %10.3f %10.3f %10.3f %10.3f %10.1f\n", stats._Name.c_str(),
+                         (unsigned long long)stats._Count, stats._Mean, stats._P50, stats._P95, stats._P99, stats._Max,
+                         stats._Total);
+        }
+    }
+
+    // pieceIDs[i]: the ID of piece i in the original puzzle (sub-graphs of removed subassemblies have their own IDs)
+    std::string FormatPieces(const PieceMask &mask, const std::vector<int> &pieceIDs)
+    {
+        std::string res;
+        for (int pieceID : mask)
+        {
+            res += res.empty() ? "{" : ", ";
+            res += std::to_string(pieceIDs[pieceID]);
+        }
+
+        return (res.empty() ? "{" : res) + "}";
+    }
+
+    // describe how the config #configID is reached from the config #prevConfigID
+    std::string DescribeStep(DisassemblyGraph &graph, int prevConfigID, int configID, const std::vector<int> &pieceIDs)
+    {
+        auto &prev = graph.GetPuzzleConfig(prevConfigID);
+        auto &curr = graph.GetPuzzleConfig(configID);
+
+        PieceMask removed = prev.GetPieceMask() & ~curr.GetPieceMask();
+        if (removed)
+        {
+            return "remove " + FormatPieces(removed, pieceIDs);
+        }
+
+        PieceMask moved;
+        int dx = 0, dz = 0;
+        for (int pieceID : curr.GetPieceMask())
+        {
+            auto &prevState = prev.GetPieceState(pieceID), &currState = curr.GetPieceState(pieceID);
+            if (!(prevState == currState))
+            {
+                moved.Add(pieceID);
+                dx = currState._OffsetX - prevState._OffsetX;
+                dz = currState._OffsetZ - prevState._OffsetZ;
+            }
+        }
+
+        return "move " + FormatPieces(moved, pieceIDs) + " by (" + std::to_string(dx) + ", " + std::to_string(dz) + ")";
+    }
+
+    // the removed subassemblies (complete plans only) are disassembled right below the step removing them
+    void PrintPlan(DisassemblyGraph &graph, const std::vector<int> &pieceIDs, int indent)
+    {
+        int prevConfigID = 0, subassemblyIndex = 0;
+        for (int i = 0; i < graph.GetDisasmPlanSize(); i++)
+        {
+            int configID = graph.GetDisasmPlanConfigID(i);
+            if (configID == prevConfigID)
+            {
+                continue; // the plan starts with the initial config
+            }
+
+            std::printf("%*s%3d. #%-6d %s\n", indent, "", i, configID, DescribeStep(graph, prevConfigID, configID, pieceIDs).c_str());
+            prevConfigID = configID;
+
+            for (; subassemblyIndex < graph.GetSubassemblyPlanNum() && graph.GetSubassemblyPlan(subassemblyIndex)._PlanOffset == i;
+                 subassemblyIndex++)
+            {
+                auto &subassemblyPlan = graph.GetSubassemblyPlan(subassemblyIndex);
+                std::vector<int> subPieceIDs;
+                for (int pieceID : subassemblyPlan._PieceMask)
+                {
+                    subPieceIDs.push_back(pieceIDs[pieceID]);
+                }
+
+                if (subassemblyPlan._Graph->IsDisasmGraphBuilt())
+                {
+                    PrintPlan(*subassemblyPlan._Graph, subPieceIDs, indent + 5);
+                }
+                else
+                {
+                    PieceMask subassemblyMask = PieceMask::FromRange(subPieceIDs.size());
+                    std::printf("%*s     %s cannot be disassembled\n", indent, "", FormatPieces(subassemblyMask, subPieceIDs).c_str());
+                }
+            }
+        }
+    }
+
+    bool Solve(const std::string &puzzleFilePath, bool complete, bool compact, SolutionCache &solutionCache)
+    {
+        namespace ch = std::chrono;
+
+        DisassemblyGraph graph;
+        graph.SetCompactStorage(compact);
+        if (!graph.ImportPuzzle(puzzleFilePath))
+        {
+            std::printf("%s: failed to import: %s\n", puzzleFilePath.c_str(), graph.GetImportError().c_str());
+            return false;
+        }
+
+        auto t1 = ch::steady_clock::now();
+        bool cached = solutionCache.Load(graph, complete);
+        if (cached)
+        {
+            // restored as if built
+        }
+        else if (complete)
+        {
+            graph.BuildCompleteDisassemblyGraph();
+        }
+        else
+        {
+            graph.BuildKernelDisassemblyGraph();
+        }
+        auto t2 = ch::steady_clock::now();
+
+        if (!cached)
+        {
+            solutionCache.Store(graph, complete);
+        }
+
+        if (!graph.IsDisasmGraphBuilt())
+        {
+            std::printf("%s: cannot be disassembled\n", puzzleFilePath.c_str());
+            return false;
+        }
+
+        std::printf("%s\n", puzzleFilePath.c_str());
+        std::printf("  pieces:     %d\n", graph.GetPuzzleConfig(0).GetPuzzlePieceNum());
+        std::printf("  difficulty: %d\n", graph.GetPuzzleDifficulty());
+        std::printf("  nodes:      %d\n", graph.GetPuzzleConfigNum());
+        std::printf("  memory:     %.1f bytes per node\n", graph.GetMemoryUsagePerNode());
+        std::printf("  time:       %.3f ms%s\n", ch::duration<double, std::milli>(t2 - t1).count(), cached ? " (cached)" : "");
+        std::printf("  plan (%s, %d configs):\n", complete ? "complete" : "kernel", graph.GetDisasmPlanSize());
+
+        std::vector<int> pieceIDs(graph.GetPuzzleConfig(0).GetPuzzlePieceNum());
+        for (int i = 0; i < static_cast<int>(pieceIDs.size()); i++)
+        {
+            pieceIDs[i] = i;
+        }
+        PrintPlan(graph, pieceIDs, 4);
+
+        return true;
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    bool complete = false, compact = false, profile = false;
+    int threadNum = 0;
+    std::vector<std::string> puzzleFilePaths;
+    SolutionCache solutionCache; // disabled unless --cache is given
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--complete")
+        {
+            complete = true;
+        }
+        else if (arg == "--compact")
+        {
+            compact = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threadNum = std::atoi(argv[++i]);
+        }
+        else if (arg == "--cache" && i + 1 < argc)
+        {
+            solutionCache.Init(argv[++i]);
+        }
+        else if (arg == "--profile")
+        {
+            profile = true;
+        }
+        else if (arg == "--help" || arg == "-h" || arg.starts_with("--"))
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+        else
+        {
+            puzzleFilePaths.push_back(arg);
+        }
+    }
+
+    if (puzzleFilePaths.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    gThreadPool.Init(threadNum);
+
+    int failedNum = 0;
+    for (auto &puzzleFilePath : puzzleFilePaths)
+    {
+        failedNum += !Solve(puzzleFilePath, complete, compact, solutionCache);
+    }
+
+    if (profile)
+    {
+        PrintProfile();
+    }
+
+    return failedNum == 0 ? 0 : 2;
+}
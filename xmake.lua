@@ -9,6 +9,14 @@ if is_mode("debug") then
     --add_defines("DETAILED_DEBUG_INFO")
 end
 
+-- the max number of pieces of a puzzle, see cMaxPieceNum in src/HLP/HLP_Config.h
+option("max-pieces")
+    set_default("256")
+    set_showmenu(true)
+    set_description("Max number of pieces of a puzzle, every 64 cost 16 bytes per graph node")
+option_end()
+add_defines("HLP_MAX_PIECE_NUM=" .. (get_config("max-pieces") or "256"))
+
 target("HLP-Demo")
     set_languages("c99", "cxx20")
     set_kind("binary")
@@ -17,6 +25,9 @@ target("HLP-Demo")
     add_files("src/**.cpp")
     add_includedirs("src")
     add_packages("glfw", "stb", "glm", "imgui", "glad")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
     
     add_options("detailed-debug-info")
 
@@ -26,3 +37,91 @@ target("HLP-Demo")
         os.cp("resources", "bin/")
     end)
 target_end()
+
+-- headless solver, no GLFW / OpenGL / ImGui
+target("HLP-Solve")
+    set_languages("cxx20")
+    set_kind("binary")
+    set_warnings("all")
+
+    add_files("tools/Solve.cpp")
+    add_files("src/HLP/DisassemblyGraph.cpp", "src/HLP/PuzzleConfig.cpp", "src/HLP/PuzzleFile.cpp", "src/HLP/SolutionCache.cpp")
+    add_files("src/Logger.cpp", "src/Profiler.cpp", "src/ThreadPool.cpp", "src/Utils.cpp")
+    add_includedirs("src")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+    after_build(function (target)
+        os.cp(target:targetfile(), "bin/")
+    end)
+target_end()
+
+target("HLP-Bench")
+    set_languages("cxx20")
+    set_kind("binary")
+    set_warnings("all")
+
+    add_files("tools/Bench.cpp")
+    add_files("src/HLP/DisassemblyGraph.cpp", "src/HLP/PuzzleConfig.cpp", "src/HLP/PuzzleFile.cpp", "src/HLP/PuzzleGenerator.cpp")
+    add_files("src/Logger.cpp", "src/Profiler.cpp", "src/ThreadPool.cpp", "src/Utils.cpp")
+    add_includedirs("src")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+    after_build(function (target)
+        os.cp(target:targetfile(), "bin/")
+    end)
+target_end()
+
+target("HLP-Batch")
+    set_languages("cxx20")
+    set_kind("binary")
+    set_warnings("all")
+
+    add_files("tools/Batch.cpp")
+    add_files("src/HLP/DisassemblyGraph.cpp", "src/HLP/PuzzleConfig.cpp", "src/HLP/PuzzleFile.cpp", "src/HLP/SolutionCache.cpp")
+    add_files("src/Logger.cpp", "src/Profiler.cpp", "src/ThreadPool.cpp", "src/Utils.cpp")
+    add_includedirs("src")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+    after_build(function (target)
+        os.cp(target:targetfile(), "bin/")
+    end)
+target_end()
+
+target("HLP-Generate")
+    set_languages("cxx20")
+    set_kind("binary")
+    set_warnings("all")
+
+    add_files("tools/Generate.cpp")
+    add_files("src/HLP/DisassemblyGraph.cpp", "src/HLP/PuzzleConfig.cpp", "src/HLP/PuzzleFile.cpp", "src/HLP/PuzzleGenerator.cpp")
+    add_files("src/Logger.cpp", "src/Profiler.cpp", "src/ThreadPool.cpp", "src/Utils.cpp")
+    add_includedirs("src")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+    after_build(function (target)
+        os.cp(target:targetfile(), "bin/")
+    end)
+target_end()
+
+target("HLP-Convert")
+    set_languages("cxx20")
+    set_kind("binary")
+    set_warnings("all")
+
+    add_files("tools/Convert.cpp")
+    add_files("src/HLP/PuzzleFile.cpp")
+    add_files("src/Logger.cpp", "src/Utils.cpp")
+    add_includedirs("src")
+
+    after_build(function (target)
+        os.cp(target:targetfile(), "bin/")
+    end)
+target_end()